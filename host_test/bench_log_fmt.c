@@ -0,0 +1,112 @@
+/*
+ * Host microbenchmark for deferred log formatting
+ *
+ * Compares what an ESP_LOG call costs its caller in the two modes of
+ * cdc_log_vprintf():
+ *   text:   vsnprintf into the 512-byte stack buffer, copy into the ring
+ *   packed: log_fmt_pack() into a 256-byte buffer, copy into the ring
+ * and what the packed line later costs the reader (log_fmt_render()).
+ * Ring bytes include the 16-byte record header and 4-byte alignment.
+ *
+ * Host numbers: use them to compare the modes, not as ESP32-S3 timings.
+ */
+
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "log_fmt.h"
+
+#define ITERATIONS      1000000
+#define REC_HDR_LEN     16          // sizeof(log_rec_hdr_t) in log_stream.c
+#define RING_BYTES      (48 * 1024)
+
+static uint8_t s_ring[RING_BYTES];
+static size_t s_ring_pos;
+static volatile size_t s_sink;
+
+static inline size_t rec_size(size_t len)
+{
+    return (REC_HDR_LEN + len + 3) & ~(size_t)3;
+}
+
+static inline void ring_copy(const void *payload, size_t len)
+{
+    if (s_ring_pos + rec_size(len) > RING_BYTES) s_ring_pos = 0;
+    memcpy(s_ring + s_ring_pos + REC_HDR_LEN, payload, len);
+    s_ring_pos += rec_size(len);
+}
+
+static size_t log_text(const char *fmt, ...)
+{
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (len >= (int)sizeof(buf)) len = sizeof(buf) - 1;
+    ring_copy(buf, len);
+    return len;
+}
+
+static size_t log_packed(const char *fmt, ...)
+{
+    uint8_t blob[256];
+    va_list ap;
+    va_start(ap, fmt);
+    size_t len = log_fmt_pack(blob, sizeof(blob), fmt, ap);
+    va_end(ap);
+    ring_copy(blob, len);
+    return len;
+}
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Same arguments for both modes; the tag is a flash string, one %s is in RAM
+#define BENCH(label, fmt, ...) do {                                             \
+        size_t text_len = 0, packed_len = 0;                                    \
+        double t0 = now_ns();                                                   \
+        for (int i = 0; i < ITERATIONS; i++) text_len = log_text(fmt, __VA_ARGS__); \
+        double t1 = now_ns();                                                   \
+        for (int i = 0; i < ITERATIONS; i++) packed_len = log_packed(fmt, __VA_ARGS__); \
+        double t2 = now_ns();                                                   \
+        uint8_t blob_[256];                                                     \
+        char out_[256];                                                         \
+        size_t n_ = 0;                                                          \
+        pack_once(blob_, &n_, fmt, __VA_ARGS__);                         \
+        double t3 = now_ns();                                                   \
+        for (int i = 0; i < ITERATIONS; i++) s_sink += log_fmt_render(out_, sizeof(out_), blob_, n_); \
+        double t4 = now_ns();                                                   \
+        printf("%-10s %8.1f %8.1f %8.1f %7zu %7zu\n", label,                    \
+               (t1 - t0) / ITERATIONS, (t2 - t1) / ITERATIONS, (t4 - t3) / ITERATIONS, \
+               rec_size(text_len), rec_size(packed_len));                       \
+    } while (0)
+
+static void pack_once(uint8_t *blob, size_t *n, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    *n = log_fmt_pack(blob, 256, fmt, ap);
+    va_end(ap);
+}
+
+int main(void)
+{
+    char ram[32];
+    snprintf(ram, sizeof(ram), "192.168.7.2");
+
+    printf("%-10s %8s %8s %8s %7s %7s\n", "line", "text ns", "pack ns", "render", "text B", "pack B");
+    BENCH("short", "I (%lu) %s: LED on\n", 123456UL, "http");
+    BENCH("typical", "I (%lu) %s: RX %u bytes from %s, queue %d/%d\n",
+          123456UL, "ncm", 1514u, ram, 3, 16);
+    BENCH("numeric", "I (%lu) %s: tx=%llu rx=%llu drops=%lu lat=%luus\n",
+          123456UL, "stats", 123456789ULL, 987654321ULL, 12UL, 250UL);
+    BENCH("float", "I (%lu) %s: ratio %.3f, temp %.1f C\n", 123456UL, "sys", 1.234, 41.5);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Host microbenchmark for pkt_classify()
+ *
+ * ns per call for the frame shapes the NCM paths see most, and for a mix
+ * weighted like bulk TCP traffic (data segments and their ACKs, with the
+ * occasional mDNS, ARP and DHCP frame). Host numbers: use them to compare
+ * changes to the classifier, not as ESP32-S3 timings.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "pkt_classify.h"
+
+#define ITERATIONS  10000000
+
+static volatile uint32_t s_sink;
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static size_t make_ipv4(uint8_t *f, uint8_t proto, uint16_t sport, uint16_t dport, size_t l4_len)
+{
+    memset(f, 0, 1514);
+    put16(f + 12, 0x0800);
+    f[14] = 0x45;
+    put16(f + 16, (uint16_t)(20 + l4_len));
+    f[23] = proto;
+    put16(f + 34, sport);
+    put16(f + 36, dport);
+    if (proto == 6) f[46] = 5 << 4;
+    return 34 + l4_len;
+}
+
+typedef struct {
+    const char *name;
+    uint8_t data[1514];
+    size_t len;
+} bench_frame_t;
+
+static bench_frame_t s_frames[5];
+
+static void build_frames(void)
+{
+    bench_frame_t *f = s_frames;
+
+    f[0].name = "tcp_data";
+    f[0].len = make_ipv4(f[0].data, 6, 49152, 80, 1480);
+    f[0].data[47] = 0x18;
+
+    f[1].name = "tcp_ack";
+    f[1].len = make_ipv4(f[1].data, 6, 80, 49152, 20);
+    f[1].data[47] = 0x10;
+
+    f[2].name = "mdns";
+    f[2].len = make_ipv4(f[2].data, 17, 5353, 5353, 8 + 40);
+
+    f[3].name = "arp";
+    memset(f[3].data, 0, sizeof(f[3].data));
+    put16(f[3].data + 12, 0x0806);
+    f[3].len = 42;
+
+    f[4].name = "dhcp";
+    f[4].len = make_ipv4(f[4].data, 17, 68, 67, 8 + 244);
+    uint8_t *b = f[4].data + 42;
+    memcpy(b + 236, "\x63\x82\x53\x63\x35\x01\x03\xff", 8);
+}
+
+static double bench(const bench_frame_t *f)
+{
+    pkt_info_t info;
+    double t0 = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        pkt_classify(f->data, f->len, &info);
+        s_sink += info.l4;
+    }
+    return (now_ns() - t0) / ITERATIONS;
+}
+
+int main(void)
+{
+    build_frames();
+
+    printf("%-10s %6s %8s\n", "frame", "bytes", "ns/call");
+    for (size_t i = 0; i < sizeof(s_frames) / sizeof(s_frames[0]); i++) {
+        printf("%-10s %6zu %8.1f\n", s_frames[i].name, s_frames[i].len, bench(&s_frames[i]));
+    }
+
+    // 16 frames: 8 data, 6 ACKs, mDNS, ARP (DHCP is too rare to weigh in)
+    static const int MIX[16] = { 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1, 0, 2, 1, 0, 3 };
+    pkt_info_t info;
+    double t0 = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        const bench_frame_t *f = &s_frames[MIX[i & 15]];
+        pkt_classify(f->data, f->len, &info);
+        s_sink += info.l4;
+    }
+    printf("%-10s %6s %8.1f\n", "mix", "-", (now_ns() - t0) / ITERATIONS);
+    return 0;
+}
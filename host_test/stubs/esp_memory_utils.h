@@ -0,0 +1,20 @@
+/*
+ * Host stub for esp_memory_utils.h
+ *
+ * On the target, esp_ptr_in_drom() tells flash-resident constants (string
+ * literals, format strings) from RAM. The host equivalent is "inside the
+ * executable image": text, rodata and initialised data (GNU ld symbols).
+ * Tests therefore keep their "RAM" strings on the stack or the heap.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+extern const char __executable_start[];
+extern const char edata[];
+
+static inline bool esp_ptr_in_drom(const void *p)
+{
+    return (const char *)p >= __executable_start && (const char *)p < edata;
+}
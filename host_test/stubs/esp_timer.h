@@ -0,0 +1,9 @@
+/*
+ * Host stub for esp_timer.h: each test provides esp_timer_get_time()
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,24 @@
+/*
+ * Host stub for freertos/FreeRTOS.h
+ *
+ * The tests are single-threaded: only the types and macros the tested
+ * modules use, with nothing behind them.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define portMAX_DELAY       UINT32_MAX
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+static inline BaseType_t xPortInIsrContext(void)
+{
+    return pdFALSE;
+}
@@ -0,0 +1,7 @@
+/*
+ * Host stub for sdkconfig.h: the Kconfig values the tested modules read
+ */
+
+#pragma once
+
+#define CONFIG_LOG_MAX_READERS 4
@@ -0,0 +1,194 @@
+/*
+ * Host test for log_fmt.c
+ *
+ * - Packed lines render byte for byte like vsnprintf
+ * - Strings outside "flash" that are too long to copy are refused, so the
+ *   line falls back to text instead of being cut short
+ * - A %s precision bounds the read, so unterminated buffers are safe
+ * - Corrupted blobs render a placeholder and never read out of bounds
+ *   (run under ASan)
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log_fmt.h"
+
+#define BLOB_MAX    256
+#define OUT_MAX     256
+
+static int s_failures = 0;
+
+#define EXPECT(cond, ...) do {                                  \
+        if (!(cond)) {                                          \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);         \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+            s_failures++;                                       \
+        }                                                       \
+    } while (0)
+
+static size_t pack(uint8_t *blob, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    size_t n = log_fmt_pack(blob, BLOB_MAX, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+// Pack and render, compare with vsnprintf of the same arguments
+static void check_same(const char *fmt, ...)
+{
+    uint8_t blob[BLOB_MAX];
+    char want[OUT_MAX];
+    char got[OUT_MAX];
+    va_list ap, ap2;
+
+    va_start(ap, fmt);
+    va_copy(ap2, ap);
+    int want_len = vsnprintf(want, sizeof(want), fmt, ap);
+    size_t n = log_fmt_pack(blob, sizeof(blob), fmt, ap2);
+    va_end(ap2);
+    va_end(ap);
+
+    EXPECT(n > 0, "\"%s\" did not pack", fmt);
+    if (n == 0) return;
+
+    size_t got_len = log_fmt_render(got, sizeof(got) - 1, blob, n);
+    got[got_len < sizeof(got) - 1 ? got_len : sizeof(got) - 1] = '\0';
+    EXPECT(got_len == (size_t)want_len && strcmp(got, want) == 0,
+           "\"%s\": rendered \"%s\" (%zu), vsnprintf \"%s\" (%d)", fmt, got, got_len, want, want_len);
+}
+
+static void test_matches_vsnprintf(void)
+{
+    char ram[32];
+    strcpy(ram, "ram string");
+
+    check_same("I (%lu) %s: plain line\n", 12345UL, "tag");
+    check_same("%d %i %u %x %X %o %c", -42, 7, 3000000000u, 0xbeef, 0xBEEF, 8, 'z');
+    check_same("%hhd %hd %ld %lld %zu %jd %td", 300, 70000, -1L, 1LL << 40, (size_t)99,
+               (intmax_t)-5, (ptrdiff_t)-6);
+    check_same("[%5d] [%-5d] [%05d] [%+d] [% d] [%#x]", 42, 42, 42, 42, 42, 42);
+    check_same("[%*d] [%-*d] [%.*s] [%.*s]", 6, 1, 6, 2, 3, "abcdef", -1, "neg");
+    check_same("%f %.2f %e %g %10.3f", 3.14159, 2.5, 12345.678, 0.0001, -1.0);
+    check_same("%s|%10s|%-10s|%.3s", ram, "right", "left", "truncate");
+    check_same("%s and %s", (const char *)NULL, ram);
+    check_same("100%% done %p", (void *)0x1234);
+    check_same("no conversions at all");
+}
+
+static void test_long_ram_strings(void)
+{
+    uint8_t blob[BLOB_MAX];
+    char s[LOG_FMT_STR_MAX + 2];
+
+    // Exactly the limit: copied whole
+    memset(s, 'a', LOG_FMT_STR_MAX);
+    s[LOG_FMT_STR_MAX] = '\0';
+    check_same("<%s>", s);
+
+    // One byte over: refused, the caller formats it as text
+    memset(s, 'b', LOG_FMT_STR_MAX + 1);
+    s[LOG_FMT_STR_MAX + 1] = '\0';
+    EXPECT(pack(blob, "<%s>", s) == 0, "%d-byte RAM string was packed", LOG_FMT_STR_MAX + 1);
+
+    // Flash strings are pointers, so their length doesn't matter
+    static const char long_flash[] =
+        "a flash-resident string well past the copy limit, which is only kept as a "
+        "pointer and therefore never truncated when the line is rendered later on";
+    check_same("<%s>", long_flash);
+}
+
+// "%.*s" on a buffer without a terminator reads only the precision's worth
+// (ASan flags a heap read past the buffer)
+static void test_unterminated_strings(void)
+{
+    uint8_t blob[BLOB_MAX];
+    char out[OUT_MAX];
+
+    char *buf = malloc(5);
+    memcpy(buf, "hello", 5);
+    check_same("[%.*s]", 5, buf);
+    check_same("[%.3s]", buf);
+    check_same("[%.5s] [%-8.*s]", buf, 2, buf);
+
+    // A precision over the copy limit still can't read past the limit + 1
+    char *big = malloc(LOG_FMT_STR_MAX + 1);
+    memset(big, 'c', LOG_FMT_STR_MAX + 1);
+    EXPECT(pack(blob, "[%.*s]", LOG_FMT_STR_MAX + 1, big) == 0,
+           "%d-byte unterminated string was packed", LOG_FMT_STR_MAX + 1);
+    size_t n = pack(blob, "[%.*s]", LOG_FMT_STR_MAX, big);
+    size_t len = log_fmt_render(out, sizeof(out), blob, n);
+    EXPECT(n > 0 && len == LOG_FMT_STR_MAX + 2, "limit-sized precision rendered %zu bytes", len);
+
+    free(big);
+    free(buf);
+}
+
+static void test_corrupt_blobs(void)
+{
+    uint8_t blob[BLOB_MAX];
+    char out[OUT_MAX];
+    char ram_fmt[16];
+    strcpy(ram_fmt, "%s %s");
+
+    // Format pointer outside flash
+    const char *bad_fmt = ram_fmt;
+    memcpy(blob, &bad_fmt, sizeof(bad_fmt));
+    size_t len = log_fmt_render(out, sizeof(out), blob, sizeof(bad_fmt));
+    EXPECT(len > 0 && len < sizeof(out) && memcmp(out, "<unreadable", 11) == 0,
+           "RAM format pointer rendered \"%.*s\"", (int)len, out);
+
+    // A STR_PTR argument outside flash
+    size_t n = pack(blob, "[%s]", "flash");
+    EXPECT(n == sizeof(char *) + 1 + sizeof(char *), "unexpected packed size %zu", n);
+    const char *bad_str = ram_fmt;
+    memcpy(blob + sizeof(char *) + 1, &bad_str, sizeof(bad_str));
+    len = log_fmt_render(out, sizeof(out), blob, n);
+    EXPECT(len == 5 && memcmp(out, "[<?>]", 5) == 0, "RAM %%s pointer rendered \"%.*s\"",
+           (int)len, out);
+
+    // An inline length over the copy limit, with that many bytes present
+    char ram[8];
+    strcpy(ram, "abc");
+    uint8_t big[BLOB_MAX + 64];
+    n = pack(big, "[%s]", ram);
+    EXPECT(n == sizeof(char *) + 2 + 3, "unexpected packed size %zu", n);
+    memset(big + n, 'x', sizeof(big) - n);
+    big[sizeof(char *) + 1] = 255;
+    len = log_fmt_render(out, sizeof(out), big, sizeof(big));
+    EXPECT(len == 4 && memcmp(out, "[<?>", 4) == 0, "oversized inline %%s rendered \"%.*s\"",
+           (int)len, out);
+
+    const char *str;
+    size_t str_len;
+    EXPECT(!log_fmt_str_arg(big, sizeof(big), 0, &str, &str_len),
+           "log_fmt_str_arg accepted an oversized inline string");
+
+    // Every truncation of a valid blob renders without reading past it
+    n = pack(blob, "%s %d %s %f %s", "tag", 42, ram, 1.5, "end");
+    for (size_t cut = 0; cut < n; cut++) {
+        uint8_t *copy = malloc(cut ? cut : 1);
+        memcpy(copy, blob, cut);
+        log_fmt_render(out, sizeof(out), copy, cut);
+        free(copy);
+    }
+}
+
+int main(void)
+{
+    test_matches_vsnprintf();
+    test_long_ram_strings();
+    test_unterminated_strings();
+    test_corrupt_blobs();
+
+    if (s_failures) {
+        printf("%d failure(s)\n", s_failures);
+        return 1;
+    }
+    printf("log_fmt: all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Host test for log_stream.c
+ *
+ * - Lines come back whole and in order, from log_buffer_get_all() and from
+ *   a reader
+ * - A writer "preempted" for a whole lap after reserving (while it reads
+ *   the clock, or between copying its text and committing) drops its line:
+ *   the newer records it was lapped by stay intact, and a reader is not
+ *   left waiting on a header that never commits
+ *
+ * Preemption is simulated from inside the writer: the test's
+ * esp_timer_get_time() and memcpy() hooks log a full lap of lines before
+ * returning. log_stream.c is included directly so the hooks reach it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void *test_memcpy(void *dst, const void *src, size_t n);
+#define memcpy test_memcpy
+#include "log_stream.c"
+#undef memcpy
+
+#define LAP_LINES   1500        // Comfortably more than one ring's worth
+
+static int s_failures = 0;
+
+#define EXPECT(cond, ...) do {                                  \
+        if (!(cond)) {                                          \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);         \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+            s_failures++;                                       \
+        }                                                       \
+    } while (0)
+
+static char s_dump[LOG_BUFFER_BYTES + 1];
+
+// Armed hooks fire once, on the next line written
+static bool s_lap_in_clock = false;
+static bool s_lap_in_copy = false;
+static int s_next = 0;          // Number of the next lap line
+
+static void log_line(int n)
+{
+    char line[96];
+    int len = snprintf(line, sizeof(line), "I (%d) test: line %d with some padding text", n, n);
+    log_buffer_add(line, (size_t)len);
+}
+
+static void log_lap(void)
+{
+    for (int i = 0; i < LAP_LINES; i++) {
+        log_line(s_next++);
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    if (s_lap_in_clock) {
+        s_lap_in_clock = false;
+        log_lap();
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *test_memcpy(void *dst, const void *src, size_t n)
+{
+    memcpy(dst, src, n);
+    bool into_ring = (uint8_t *)dst >= s_log_ring && (uint8_t *)dst < s_log_ring + LOG_BUFFER_BYTES;
+    if (s_lap_in_copy && into_ring) {
+        s_lap_in_copy = false;
+        log_lap();
+    }
+    return dst;
+}
+
+// Line numbers in the dump must strictly increase and end at last
+static void check_dump(int last, int marker)
+{
+    size_t len = log_buffer_get_all(s_dump, sizeof(s_dump), NULL);
+    s_dump[len] = '\0';
+
+    int prev = -1;
+    int lines = 0;
+    for (const char *s = s_dump; (s = strstr(s, "test: line ")) != NULL; s++) {
+        int n = atoi(s + 11);
+        EXPECT(n > prev, "line %d after %d", n, prev);
+        EXPECT(n != marker, "dropped line %d is in the ring", marker);
+        prev = n;
+        lines++;
+    }
+    EXPECT(prev == last, "last line %d, expected %d", prev, last);
+    EXPECT(lines > 100, "only %d lines survived", lines);
+}
+
+// A reader must reach the newest line, not stall at the dropped one
+static void check_reader(int reader, int last)
+{
+    const char *line;
+    size_t len;
+    int prev = -1;
+    while ((line = log_buffer_read(reader, &len)) != NULL) {
+        const char *at = strstr(line, "test: line ");
+        if (at) prev = atoi(at + 11);
+    }
+    EXPECT(prev == last, "reader stopped at line %d, expected %d", prev, last);
+}
+
+static void test_in_order(void)
+{
+    int reader = log_buffer_alloc_reader("test");
+    EXPECT(reader >= 0, "no reader");
+
+    for (int i = 0; i < 300; i++) {
+        log_line(s_next++);
+    }
+    check_dump(s_next - 1, -1);
+    check_reader(reader, s_next - 1);
+    log_buffer_free_reader(reader);
+}
+
+static void test_lapped(bool in_copy)
+{
+    int reader = log_buffer_alloc_reader("test");
+    check_reader(reader, s_next - 1);
+
+    uint32_t dropped = log_buffer_get_dropped();
+    int marker = 1000000 + in_copy;
+    if (in_copy) {
+        s_lap_in_copy = true;
+    } else {
+        s_lap_in_clock = true;
+    }
+    log_line(marker);
+
+    EXPECT(log_buffer_get_dropped() == dropped + 1, "%s: dropped %u, expected %u",
+           in_copy ? "copy" : "clock", log_buffer_get_dropped(), dropped + 1);
+    check_dump(s_next - 1, marker);
+
+    // New lines after the dropped one still get through
+    log_line(s_next++);
+    check_reader(reader, s_next - 1);
+    check_dump(s_next - 1, marker);
+    log_buffer_free_reader(reader);
+}
+
+int main(void)
+{
+    log_buffer_init();
+
+    test_in_order();
+    test_lapped(false);
+    test_lapped(true);
+
+    if (s_failures) {
+        printf("%d failure(s)\n", s_failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,299 @@
+/*
+ * Host test for pkt_classify.c
+ *
+ * - Known frames classify as expected, including DHCP inside an IPv4
+ *   header with options (IHL > 5), VLAN tags and Ethernet padding
+ * - Truncated-length sweep: every prefix of every frame is classified from
+ *   an exactly-sized heap copy (ASan catches any over-read); a cut IP frame
+ *   is flagged PKT_F_TRUNCATED and no offset points past the cut
+ * - Invalid but complete headers (version nibble, IHL, TCP offset) are
+ *   flagged PKT_F_MALFORMED, not truncated
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pkt_classify.h"
+
+#define FRAME_MAX   1600
+
+static int s_failures = 0;
+
+#define EXPECT(cond, ...) do {                                  \
+        if (!(cond)) {                                          \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);         \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+            s_failures++;                                       \
+        }                                                       \
+    } while (0)
+
+typedef struct {
+    uint8_t data[FRAME_MAX];
+    size_t len;
+} frame_t;
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static size_t eth(frame_t *f, uint16_t ethertype, bool vlan)
+{
+    memset(f, 0, sizeof(*f));
+    memset(f->data, 0xFF, 6);                       // Broadcast destination
+    memcpy(f->data + 6, "\x02\x00\x00\x00\x00\x01", 6);
+    size_t off = 12;
+    if (vlan) {
+        put16(f->data + off, 0x8100);
+        put16(f->data + off + 2, 7);
+        off += 4;
+    }
+    put16(f->data + off, ethertype);
+    return off + 2;
+}
+
+// IPv4 header with opt_words 32-bit words of options (NOPs); returns the L4 offset
+static size_t ipv4(frame_t *f, size_t off, uint8_t proto, size_t l4_len, int opt_words)
+{
+    size_t ihl = 20 + (size_t)opt_words * 4;
+    uint8_t *ip = f->data + off;
+    ip[0] = (uint8_t)(0x40 | (ihl / 4));
+    put16(ip + 2, (uint16_t)(ihl + l4_len));
+    ip[8] = 64;
+    ip[9] = proto;
+    memcpy(ip + 12, "\xC0\xA8\x07\x01", 4);
+    memcpy(ip + 16, "\xC0\xA8\x07\x02", 4);
+    memset(ip + 20, 0x01, ihl - 20);
+    return off + ihl;
+}
+
+static size_t udp(frame_t *f, size_t off, uint16_t sport, uint16_t dport, size_t payload_len)
+{
+    put16(f->data + off, sport);
+    put16(f->data + off + 2, dport);
+    put16(f->data + off + 4, (uint16_t)(8 + payload_len));
+    return off + 8;
+}
+
+#define DHCP_LEN    (236 + 4 + 3 + 1)   // BOOTP, cookie, option 53, end
+
+static void make_dhcp(frame_t *f, uint8_t msg, int opt_words, bool vlan)
+{
+    size_t off = eth(f, 0x0800, vlan);
+    off = ipv4(f, off, 17, 8 + DHCP_LEN, opt_words);
+    bool from_server = (msg == PKT_DHCP_OFFER || msg == PKT_DHCP_ACK);
+    off = udp(f, off, from_server ? 67 : 68, from_server ? 68 : 67, DHCP_LEN);
+
+    uint8_t *b = f->data + off;
+    b[0] = from_server ? 2 : 1;
+    memcpy(b + 16, "\xC0\xA8\x07\x02", 4);          // yiaddr
+    memcpy(b + 236, "\x63\x82\x53\x63", 4);
+    b[240] = 53;
+    b[241] = 1;
+    b[242] = msg;
+    b[243] = 255;
+    f->len = off + DHCP_LEN;
+}
+
+static void make_tcp(frame_t *f, uint8_t tcp_flags, size_t payload_len)
+{
+    size_t off = eth(f, 0x0800, false);
+    off = ipv4(f, off, 6, 20 + payload_len, 0);
+    uint8_t *t = f->data + off;
+    put16(t, 49152);
+    put16(t + 2, 80);
+    t[12] = 5 << 4;
+    t[13] = tcp_flags;
+    memset(t + 20, 'x', payload_len);
+    f->len = off + 20 + payload_len;
+}
+
+static void make_mdns6(frame_t *f)
+{
+    size_t off = eth(f, 0x86DD, false);
+    uint8_t *ip = f->data + off;
+    ip[0] = 0x60;
+    put16(ip + 4, 8 + 12);
+    ip[6] = 17;
+    ip[7] = 255;
+    off = udp(f, off + 40, 5353, 5353, 12);
+    f->len = off + 12;
+}
+
+static void make_arp(frame_t *f)
+{
+    size_t off = eth(f, 0x0806, false);
+    f->len = off + 28;
+}
+
+static void classify(const frame_t *f, size_t len, pkt_info_t *info)
+{
+    // Exactly len bytes on the heap, so any over-read is an ASan error
+    uint8_t *copy = malloc(len ? len : 1);
+    memcpy(copy, f->data, len);
+    pkt_classify(copy, len, info);
+    free(copy);
+}
+
+static void test_dhcp(void)
+{
+    static const uint8_t MSGS[] = { PKT_DHCP_DISCOVER, PKT_DHCP_OFFER, PKT_DHCP_REQUEST, PKT_DHCP_ACK };
+    frame_t f;
+    pkt_info_t info;
+
+    for (size_t i = 0; i < sizeof(MSGS); i++) {
+        for (int opt_words = 0; opt_words <= 10; opt_words += 5) {
+            make_dhcp(&f, MSGS[i], opt_words, false);
+            classify(&f, f.len, &info);
+            EXPECT(info.l3 == PKT_L3_IPV4 && info.l4 == PKT_L4_UDP && info.app == PKT_APP_DHCP,
+                   "DHCP %s, %d option words: l3 %u l4 %u app %u", pkt_dhcp_msg_name(MSGS[i]),
+                   opt_words, info.l3, info.l4, info.app);
+            EXPECT(info.dhcp_msg == MSGS[i], "DHCP %s, %d option words: got msg %u",
+                   pkt_dhcp_msg_name(MSGS[i]), opt_words, info.dhcp_msg);
+            EXPECT(info.l4_off == 14 + 20 + opt_words * 4, "l4_off %u with %d option words",
+                   info.l4_off, opt_words);
+            EXPECT(((info.flags & PKT_F_IP_OPTIONS) != 0) == (opt_words > 0) &&
+                   !(info.flags & PKT_F_TRUNCATED), "flags 0x%x with %d option words",
+                   info.flags, opt_words);
+            EXPECT(memcmp(info.dhcp_yiaddr, "\xC0\xA8\x07\x02", 4) == 0, "yiaddr not read");
+        }
+    }
+
+    // VLAN-tagged, with Ethernet padding after the IP datagram
+    make_dhcp(&f, PKT_DHCP_REQUEST, 1, true);
+    memset(f.data + f.len, 0, 20);
+    classify(&f, f.len + 20, &info);
+    EXPECT(info.dhcp_msg == PKT_DHCP_REQUEST && (info.flags & PKT_F_VLAN) &&
+           !(info.flags & PKT_F_TRUNCATED), "VLAN DHCP: msg %u flags 0x%x", info.dhcp_msg, info.flags);
+    EXPECT(info.payload_len == DHCP_LEN, "padding counted as payload (%u)", info.payload_len);
+
+    // An IHL below 5 is malformed, not an invitation to read backwards
+    make_dhcp(&f, PKT_DHCP_DISCOVER, 0, false);
+    f.data[14] = 0x44;
+    classify(&f, f.len, &info);
+    EXPECT((info.flags & PKT_F_MALFORMED) && !(info.flags & PKT_F_TRUNCATED) &&
+           info.l4 == PKT_L4_NONE, "IHL 4: flags 0x%x l4 %u", info.flags, info.l4);
+
+    // Wrong version nibble: malformed, not a cut frame
+    make_dhcp(&f, PKT_DHCP_DISCOVER, 0, false);
+    f.data[14] = 0x65;
+    classify(&f, f.len, &info);
+    EXPECT((info.flags & PKT_F_MALFORMED) && !(info.flags & PKT_F_TRUNCATED) &&
+           info.l4 == PKT_L4_NONE, "IPv4 version 6: flags 0x%x l4 %u", info.flags, info.l4);
+
+    // Total length shorter than the header itself
+    make_dhcp(&f, PKT_DHCP_DISCOVER, 0, false);
+    put16(f.data + 14 + 2, 12);
+    classify(&f, f.len, &info);
+    EXPECT((info.flags & PKT_F_MALFORMED) && !(info.flags & PKT_F_TRUNCATED),
+           "IPv4 total length 12: flags 0x%x", info.flags);
+}
+
+static void test_tcp_and_others(void)
+{
+    frame_t f;
+    pkt_info_t info;
+
+    make_tcp(&f, 0x02, 0);
+    classify(&f, f.len, &info);
+    EXPECT(info.l4 == PKT_L4_TCP && (info.flags & PKT_F_TCP_SYN) && info.dst_port == 80,
+           "SYN: l4 %u flags 0x%x port %u", info.l4, info.flags, info.dst_port);
+
+    make_tcp(&f, 0x10, 0);
+    classify(&f, f.len, &info);
+    EXPECT(info.flags & PKT_F_TCP_PURE_ACK, "pure ACK not flagged (0x%x)", info.flags);
+
+    make_tcp(&f, 0x18, 1400);
+    classify(&f, f.len, &info);
+    EXPECT(!(info.flags & PKT_F_TCP_PURE_ACK) && info.payload_len == 1400,
+           "data segment: flags 0x%x payload %u", info.flags, info.payload_len);
+
+    // TCP data offset below 5 words
+    make_tcp(&f, 0x10, 0);
+    f.data[14 + 20 + 12] = 0x40;
+    classify(&f, f.len, &info);
+    EXPECT((info.flags & PKT_F_MALFORMED) && !(info.flags & PKT_F_TRUNCATED) &&
+           info.src_port == 0, "TCP offset 4: flags 0x%x", info.flags);
+
+    make_mdns6(&f);
+    classify(&f, f.len, &info);
+    EXPECT(info.l3 == PKT_L3_IPV6 && info.l4 == PKT_L4_UDP && info.app == PKT_APP_MDNS,
+           "mDNS over IPv6: l3 %u l4 %u app %u", info.l3, info.l4, info.app);
+
+    f.data[14] = 0x40;
+    classify(&f, f.len, &info);
+    EXPECT((info.flags & PKT_F_MALFORMED) && !(info.flags & PKT_F_TRUNCATED),
+           "IPv6 version 4: flags 0x%x", info.flags);
+
+    make_arp(&f);
+    classify(&f, f.len, &info);
+    EXPECT(info.l3 == PKT_L3_ARP && info.l4 == PKT_L4_NONE, "ARP: l3 %u", info.l3);
+
+    // Non-first fragment: no L4 header to parse
+    make_tcp(&f, 0x10, 100);
+    put16(f.data + 14 + 6, 185);
+    classify(&f, f.len, &info);
+    EXPECT((info.flags & PKT_F_FRAGMENT) && info.l4 == PKT_L4_NONE, "fragment parsed as L4");
+}
+
+static void sweep(const char *name, const frame_t *f, bool ip)
+{
+    pkt_info_t info;
+
+    for (size_t len = 0; len < f->len; len++) {
+        classify(f, len, &info);
+        EXPECT(info.l3_off <= len && info.l4_off <= len && info.payload_off + info.payload_len <= len,
+               "%s cut at %zu: offsets l3 %u l4 %u payload %u+%u", name, len, info.l3_off,
+               info.l4_off, info.payload_off, info.payload_len);
+        if (ip || len < 14) {
+            EXPECT(info.flags & PKT_F_TRUNCATED, "%s cut at %zu of %zu not flagged truncated",
+                   name, len, f->len);
+        }
+    }
+}
+
+static void test_truncated_sweep(void)
+{
+    frame_t f;
+
+    make_dhcp(&f, PKT_DHCP_DISCOVER, 0, false);
+    sweep("DHCP", &f, true);
+    make_dhcp(&f, PKT_DHCP_ACK, 10, true);
+    sweep("VLAN DHCP with IP options", &f, true);
+    make_tcp(&f, 0x10, 0);
+    sweep("TCP ACK", &f, true);
+    make_tcp(&f, 0x18, 64);
+    sweep("TCP data", &f, true);
+    make_mdns6(&f);
+    sweep("IPv6 mDNS", &f, true);
+    make_arp(&f);
+    sweep("ARP", &f, false);
+
+    // Random garbage of every length must not crash or over-read either
+    srand(1);
+    for (int i = 0; i < 20000; i++) {
+        f.len = (size_t)(rand() % 400);
+        for (size_t j = 0; j < f.len; j++) f.data[j] = (uint8_t)rand();
+        if (f.len > 13 && (i & 1)) put16(f.data + 12, (i & 2) ? 0x0800 : 0x86DD);
+        if (f.len > 14 && (i & 1)) f.data[14] = (i & 2) ? 0x45 : 0x60;
+        pkt_info_t info;
+        classify(&f, f.len, &info);
+    }
+}
+
+int main(void)
+{
+    test_dhcp();
+    test_tcp_and_others();
+    test_truncated_sweep();
+
+    if (s_failures) {
+        printf("%d failure(s)\n", s_failures);
+        return 1;
+    }
+    printf("pkt_classify: all tests passed\n");
+    return 0;
+}
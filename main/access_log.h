@@ -0,0 +1,55 @@
+/*
+ * HTTP Access Log Header
+ * Fixed-size binary record ring, one record per HTTP request
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One served request
+ */
+typedef struct {
+    uint32_t ts_ms;         // Request start, ms since boot
+    uint32_t latency_us;    // Handler entry to response sent
+    uint32_t bytes;         // Response body bytes
+    uint16_t status;        // HTTP status code
+    uint8_t method;         // httpd_method_t
+    uint8_t route;          // Route id, defined by the caller
+    int16_t sock;           // Socket descriptor
+    uint16_t reserved;
+} access_log_rec_t;
+
+/**
+ * @brief Append a record, overwriting the oldest once the ring is full
+ *
+ * Costs a 20-byte copy under a spinlock; no formatting, no allocation.
+ */
+void access_log_record(const access_log_rec_t *rec);
+
+/**
+ * @brief Copy records by sequence number (the nth record ever written is n)
+ *
+ * @param first  Sequence number of the first record wanted; older ones
+ *               already overwritten are skipped
+ * @param out    Output array
+ * @param max    Capacity of out
+ * @param next   Output: sequence number to pass as first next time
+ * @return Number of records copied
+ */
+size_t access_log_read(uint32_t first, access_log_rec_t *out, size_t max, uint32_t *next);
+
+/**
+ * @brief Records written since boot
+ */
+uint32_t access_log_total(void);
+
+#ifdef __cplusplus
+}
+#endif
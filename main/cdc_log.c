@@ -0,0 +1,195 @@
+/*
+ * CDC Log Drain Implementation
+ * Background task that copies the log ring to the USB CDC-ACM serial port
+ *
+ * Design:
+ * - The drain is just another log ring reader, so logging never touches
+ *   USB: a line costs the caller one ring append whatever the host does
+ * - Lines are collected into one buffer and handed to TinyUSB in multiples
+ *   of the 64-byte bulk packet size; a partial packet is only sent once the
+ *   oldest byte in it has waited CONFIG_LOG_CDC_FLUSH_MS
+ * - With no terminal attached the reader is parked at the ring head, so a
+ *   new terminal starts with live output (history is on /logs_all)
+ * - If the host stops reading, the ring laps the drain and the lost lines
+ *   are counted and announced in the serial output
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cdc_log.h"
+#include "log_stream.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "tusb_cdc_acm.h"
+#include "tinyusb.h"
+
+#define CDC_LOG_PACKET          64      // Full-speed bulk max packet size
+#define CDC_LOG_BATCH           (CONFIG_LOG_CDC_BATCH_BYTES & ~(CDC_LOG_PACKET - 1))
+#define CDC_LOG_LINE_MAX        256     // Longest line the ring returns
+#define CDC_LOG_NOTICE_MAX      48      // "[N log lines dropped]" notice
+#define CDC_LOG_BUF_SIZE        (CDC_LOG_BATCH + CDC_LOG_LINE_MAX + CDC_LOG_NOTICE_MAX)
+#define CDC_LOG_IDLE_MS         100     // Recheck the terminal this often while idle
+#define CDC_LOG_WRITE_TIMEOUT_MS 50     // Per attempt while the TX FIFO is full
+#define CDC_LOG_WRITE_TRIES     4
+#define CDC_LOG_TASK_STACK      3072
+
+static int s_reader = -1;
+static TaskHandle_t s_task = NULL;
+static char s_buf[CDC_LOG_BUF_SIZE];
+
+static volatile bool s_connected = false;
+static uint32_t s_lines_sent = 0;
+static uint32_t s_bytes_sent = 0;
+static uint32_t s_writes = 0;
+static uint32_t s_backlog = 0;
+static uint32_t s_dropped = 0;
+static uint32_t s_stalls = 0;
+
+// Queue len bytes on the CDC FIFO; returns how many TinyUSB accepted
+static size_t cdc_write(const char *data, size_t len, bool flush)
+{
+    size_t sent = 0;
+    int tries = 0;
+
+    while (sent < len && tries < CDC_LOG_WRITE_TRIES) {
+        size_t n = tinyusb_cdcacm_write_queue(TINYUSB_CDC_ACM_0, (const uint8_t *)data + sent,
+                                              len - sent);
+        sent += n;
+        if (sent < len) {
+            // FIFO full: wait for the host to take some of it
+            if (n == 0) tries++;
+            tinyusb_cdcacm_write_flush(TINYUSB_CDC_ACM_0, pdMS_TO_TICKS(CDC_LOG_WRITE_TIMEOUT_MS));
+        }
+    }
+
+    if (sent < len) {
+        s_stalls++;
+    } else if (flush) {
+        // Whole packets go out on their own; this pushes the short tail
+        tinyusb_cdcacm_write_flush(TINYUSB_CDC_ACM_0, 0);
+    }
+
+    s_writes++;
+    s_bytes_sent += sent;
+    return sent;
+}
+
+static void cdc_log_task(void *arg)
+{
+    size_t used = 0;
+    uint32_t reported = 0;
+    TickType_t first = 0;       // When the oldest unsent byte was read
+
+    for (;;) {
+        if (!tud_cdc_connected()) {
+            s_connected = false;
+            used = 0;
+            log_buffer_skip_to_head(s_reader);
+            reported = log_buffer_reader_missed(s_reader);
+            s_backlog = 0;
+            vTaskDelay(pdMS_TO_TICKS(CDC_LOG_IDLE_MS));
+            continue;
+        }
+        s_connected = true;
+
+        // Read what fits, leaving room in front for a drop notice. A batch
+        // stops before a gap, so a gap can only sit before its first line.
+        size_t n = 0;
+        uint32_t lines = 0;
+        if (used < CDC_LOG_BATCH) {
+            char *dst = s_buf + used + CDC_LOG_NOTICE_MAX;
+            n = log_buffer_read_batch(s_reader, dst, CDC_LOG_BUF_SIZE - used - CDC_LOG_NOTICE_MAX,
+                                      NULL, NULL, &lines);
+
+            uint32_t missed = log_buffer_reader_missed(s_reader);
+            size_t k = 0;
+            if (missed != reported) {
+                k = (size_t)snprintf(s_buf + used, CDC_LOG_NOTICE_MAX, "\r\n[%lu log lines dropped]\r\n",
+                                     (unsigned long)(missed - reported));
+                s_dropped += missed - reported;
+                reported = missed;
+            }
+            memmove(s_buf + used + k, dst, n);
+
+            if (used == 0 && k + n > 0) {
+                first = xTaskGetTickCount();
+            }
+            used += k + n;
+            s_lines_sent += lines;
+        }
+        s_backlog = used;
+
+        if (used == 0) {
+            log_buffer_wait(s_reader, CDC_LOG_IDLE_MS);
+            continue;
+        }
+
+        // Enough for full packets: send them now, keep the remainder
+        size_t len = 0;
+        bool flush = false;
+        if (used >= CDC_LOG_BATCH) {
+            len = used & ~(size_t)(CDC_LOG_PACKET - 1);
+        } else {
+            TickType_t waited = xTaskGetTickCount() - first;
+            if (waited < pdMS_TO_TICKS(CONFIG_LOG_CDC_FLUSH_MS)) {
+                if (n == 0) {
+                    log_buffer_wait(s_reader,
+                                    pdTICKS_TO_MS(pdMS_TO_TICKS(CONFIG_LOG_CDC_FLUSH_MS) - waited));
+                }
+                continue;
+            }
+            len = used;
+            flush = true;
+        }
+
+        size_t sent = cdc_write(s_buf, len, flush);
+        if (sent > 0) {
+            log_buffer_mark_delivered(s_reader, sent);
+        }
+        memmove(s_buf, s_buf + sent, used - sent);
+        used -= sent;
+        if (used > 0) {
+            first = xTaskGetTickCount();
+        }
+        s_backlog = used;
+    }
+}
+
+// ----------------------------
+// Public API
+// ----------------------------
+esp_err_t cdc_log_start(void)
+{
+    if (s_task) return ESP_OK;
+
+    s_reader = log_buffer_alloc_reader("cdc");
+    if (s_reader < 0) {
+        return ESP_FAIL;
+    }
+    log_buffer_skip_to_head(s_reader);
+
+    if (xTaskCreatePinnedToCore(cdc_log_task, "cdc_log", CDC_LOG_TASK_STACK, NULL,
+                                CONFIG_LOG_CDC_TASK_PRIORITY, &s_task, tskNO_AFFINITY) != pdPASS) {
+        log_buffer_free_reader(s_reader);
+        s_reader = -1;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void cdc_log_get_stats(cdc_log_stats_t *out)
+{
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+
+    out->connected = s_connected;
+    out->lines_sent = s_lines_sent;
+    out->bytes_sent = s_bytes_sent;
+    out->writes = s_writes;
+    out->backlog_bytes = s_backlog;
+    out->dropped_lines = s_dropped;
+    out->stalls = s_stalls;
+    if (s_reader >= 0) {
+        out->lag_bytes = log_buffer_reader_lag(s_reader);
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * CDC Log Drain Header
+ * Background task that copies the log ring to the USB CDC-ACM serial port
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    bool connected;             // Terminal attached (DTR set)
+    uint32_t lines_sent;        // Lines taken from the ring for USB
+    uint32_t bytes_sent;
+    uint32_t writes;            // Batches handed to TinyUSB
+    uint32_t backlog_bytes;     // Read from the ring but not yet accepted by USB
+    uint32_t lag_bytes;         // Still in the ring, not yet read
+    uint32_t dropped_lines;     // Overwritten before the host took them
+    uint32_t stalls;            // Writes that timed out with the host not reading
+} cdc_log_stats_t;
+
+/**
+ * @brief Start the CDC log drain task
+ *
+ * Takes one log reader slot. From then on log lines only have to be added
+ * to the log ring; this task formats and sends them at low priority.
+ *
+ * @return ESP_OK, or ESP_FAIL if the reader or the task could not be created
+ */
+esp_err_t cdc_log_start(void);
+
+/**
+ * @brief Get CDC drain counters
+ */
+void cdc_log_get_stats(cdc_log_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
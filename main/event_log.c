@@ -11,7 +11,7 @@
 #include "esp_timer.h"
 
 #define MAX_EVENTS 30
-#define MAX_DETAIL_LEN 64
+#define MAX_DETAIL_LEN EVENT_LOG_DETAIL_LEN
 
 // Event names for display
 static const char *EVENT_NAMES[] = {
@@ -30,15 +30,12 @@ static const char *EVENT_NAMES[] = {
     "DHCP_ASSIGNED",
 };
 
-typedef struct {
-    uint32_t timestamp_ms;
-    event_type_t type;
-    char detail[MAX_DETAIL_LEN];
-} event_entry_t;
+typedef event_log_entry_t event_entry_t;
 
 static event_entry_t s_events[MAX_EVENTS];
 static int s_event_count = 0;
 static bool s_event_occurred[EVT_COUNT] = {false};
+static uint32_t s_type_count[EVT_COUNT];    // Keeps counting after s_events is full
 static SemaphoreHandle_t s_mutex = NULL;
 
 void event_log_init(void)
@@ -47,6 +44,7 @@ void event_log_init(void)
     s_event_count = 0;
     memset(s_events, 0, sizeof(s_events));
     memset(s_event_occurred, 0, sizeof(s_event_occurred));
+    memset(s_type_count, 0, sizeof(s_type_count));
 }
 
 void event_log_record(event_type_t type, const char *detail)
@@ -56,6 +54,7 @@ void event_log_record(event_type_t type, const char *detail)
     if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(50)) == pdTRUE) {
         // Mark event as occurred
         s_event_occurred[type] = true;
+        s_type_count[type]++;
 
         // Add to event list if room
         if (s_event_count < MAX_EVENTS) {
@@ -89,6 +88,55 @@ bool event_log_has(event_type_t type)
     return result;
 }
 
+size_t event_log_count(void)
+{
+    return (size_t)__atomic_load_n(&s_event_count, __ATOMIC_ACQUIRE);
+}
+
+uint32_t event_log_flags(void)
+{
+    if (!s_mutex) return 0;
+
+    uint32_t flags = 0;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+        for (int i = 0; i < EVT_COUNT; i++) {
+            if (s_event_occurred[i]) flags |= 1u << i;
+        }
+        xSemaphoreGive(s_mutex);
+    }
+    return flags;
+}
+
+void event_log_type_counts(uint32_t counts[EVT_COUNT])
+{
+    memset(counts, 0, EVT_COUNT * sizeof(uint32_t));
+    if (!s_mutex) return;
+
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+        memcpy(counts, s_type_count, sizeof(s_type_count));
+        xSemaphoreGive(s_mutex);
+    }
+}
+
+const char *event_log_type_name(event_type_t type)
+{
+    return (type < EVT_COUNT) ? EVENT_NAMES[type] : "UNKNOWN";
+}
+
+size_t event_log_read(size_t first, event_log_entry_t *out, size_t max)
+{
+    if (!s_mutex || !out) return 0;
+
+    size_t n = 0;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+        for (size_t i = first; i < (size_t)s_event_count && n < max; i++) {
+            out[n++] = s_events[i];
+        }
+        xSemaphoreGive(s_mutex);
+    }
+    return n;
+}
+
 size_t event_log_get_all(char *buf, size_t size)
 {
     if (!s_mutex || !buf || size == 0) return 0;
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -31,6 +32,17 @@ typedef enum {
     EVT_COUNT               // Number of event types
 } event_type_t;
 
+#define EVENT_LOG_DETAIL_LEN 64
+
+/**
+ * @brief One recorded event
+ */
+typedef struct {
+    uint32_t timestamp_ms;
+    event_type_t type;
+    char detail[EVENT_LOG_DETAIL_LEN];
+} event_log_entry_t;
+
 /**
  * @brief Initialize the event log
  * Call once at startup before any events are recorded.
@@ -53,6 +65,39 @@ void event_log_record(event_type_t type, const char *detail);
  */
 bool event_log_has(event_type_t type);
 
+/**
+ * @brief Number of events recorded so far (only ever grows)
+ */
+size_t event_log_count(void);
+
+/**
+ * @brief Bitmask of event types that have occurred (bit n = event_type_t n)
+ */
+uint32_t event_log_flags(void);
+
+/**
+ * @brief Times each event type was recorded, including occurrences that
+ * no longer fit in the event list
+ *
+ * @param counts  Output: one count per event_type_t
+ */
+void event_log_type_counts(uint32_t counts[EVT_COUNT]);
+
+/**
+ * @brief Display name of an event type ("DHCP_ACK_TX")
+ */
+const char *event_log_type_name(event_type_t type);
+
+/**
+ * @brief Copy recorded events, oldest first
+ *
+ * @param first  Index of the first event wanted
+ * @param out    Output array
+ * @param max    Capacity of out
+ * @return Number of events copied
+ */
+size_t event_log_read(size_t first, event_log_entry_t *out, size_t max);
+
 /**
  * @brief Get all events as formatted text
  *
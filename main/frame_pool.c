@@ -0,0 +1,78 @@
+/*
+ * Frame Pool Implementation
+ * Fixed-size preallocated buffer pool for the USB NCM data path
+ *
+ * Design:
+ * - Storage is owned by the caller (normally a static array), so the
+ *   data path never touches the general heap after boot
+ * - Free buffers are tracked as a stack of indices (LIFO keeps recently
+ *   used buffers warm)
+ * - A spinlock protects the stack; critical sections are a few loads/stores
+ */
+
+#include <string.h>
+#include "frame_pool.h"
+
+void frame_pool_init(frame_pool_t *pool, void *storage, size_t elem_size,
+                     uint16_t *free_stack, uint16_t count)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->storage = (uint8_t *)storage;
+    pool->elem_size = elem_size;
+    pool->count = count;
+    pool->free_stack = free_stack;
+    portMUX_INITIALIZE(&pool->lock);
+
+    // Push in reverse so the first alloc hands out element 0
+    for (uint16_t i = 0; i < count; i++) {
+        free_stack[i] = (uint16_t)(count - 1 - i);
+    }
+    pool->free_top = count;
+    pool->stats.capacity = count;
+}
+
+void *frame_pool_alloc(frame_pool_t *pool)
+{
+    void *elem = NULL;
+
+    portENTER_CRITICAL_SAFE(&pool->lock);
+    if (pool->free_top > 0) {
+        uint16_t idx = pool->free_stack[--pool->free_top];
+        elem = pool->storage + (size_t)idx * pool->elem_size;
+
+        pool->stats.allocs++;
+        pool->stats.in_use++;
+        if (pool->stats.in_use > pool->stats.in_use_hwm) {
+            pool->stats.in_use_hwm = pool->stats.in_use;
+        }
+    } else {
+        pool->stats.exhausted++;
+    }
+    portEXIT_CRITICAL_SAFE(&pool->lock);
+
+    return elem;
+}
+
+void frame_pool_free(frame_pool_t *pool, void *elem)
+{
+    if (!elem) return;
+
+    size_t offset = (size_t)((uint8_t *)elem - pool->storage);
+    uint16_t idx = (uint16_t)(offset / pool->elem_size);
+
+    portENTER_CRITICAL_SAFE(&pool->lock);
+    if (idx < pool->count && pool->free_top < pool->count) {
+        pool->free_stack[pool->free_top++] = idx;
+        pool->stats.in_use--;
+    }
+    portEXIT_CRITICAL_SAFE(&pool->lock);
+}
+
+void frame_pool_get_stats(frame_pool_t *pool, frame_pool_stats_t *out)
+{
+    if (!out) return;
+
+    portENTER_CRITICAL_SAFE(&pool->lock);
+    *out = pool->stats;
+    portEXIT_CRITICAL_SAFE(&pool->lock);
+}
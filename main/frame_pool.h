@@ -0,0 +1,73 @@
+/*
+ * Frame Pool Header
+ * Fixed-size preallocated buffer pool for the USB NCM data path
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Snapshot of pool usage counters
+ */
+typedef struct {
+    uint32_t capacity;      // Number of buffers in the pool
+    uint32_t in_use;        // Buffers currently handed out
+    uint32_t in_use_hwm;    // Peak of in_use since init
+    uint32_t allocs;        // Successful allocations
+    uint32_t exhausted;     // Allocation attempts that found the pool empty
+} frame_pool_stats_t;
+
+/**
+ * @brief Pool of equally sized buffers carved out of caller-provided storage
+ *
+ * The free list is a stack of element indices guarded by a spinlock, so
+ * alloc/free are O(1) and safe from any task on either core.
+ */
+typedef struct {
+    uint8_t *storage;
+    size_t elem_size;
+    uint16_t count;
+    uint16_t *free_stack;
+    uint16_t free_top;      // Number of entries on free_stack
+    portMUX_TYPE lock;
+    frame_pool_stats_t stats;
+} frame_pool_t;
+
+/**
+ * @brief Initialize a pool over static storage
+ *
+ * @param pool        Pool to initialize
+ * @param storage     count * elem_size bytes (keep elem_size a multiple of 4)
+ * @param elem_size   Size of one buffer in bytes
+ * @param free_stack  Scratch array of count entries used for the free list
+ * @param count       Number of buffers
+ */
+void frame_pool_init(frame_pool_t *pool, void *storage, size_t elem_size,
+                     uint16_t *free_stack, uint16_t count);
+
+/**
+ * @brief Take a buffer from the pool
+ * @return Buffer pointer, or NULL if the pool is exhausted
+ */
+void *frame_pool_alloc(frame_pool_t *pool);
+
+/**
+ * @brief Return a buffer obtained from frame_pool_alloc()
+ */
+void frame_pool_free(frame_pool_t *pool, void *elem);
+
+/**
+ * @brief Copy the pool's usage counters
+ */
+void frame_pool_get_stats(frame_pool_t *pool, frame_pool_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,9 +4,13 @@
  *
  * This server runs on lwIP's TCP stack at 192.168.7.1:80
  * It provides:
- *   - Status page (GET /)
+ *   - Status page and dashboard (GET /, /dashboard; gzipped from main/www)
  *   - LED control (GET/POST /led, /led/on, /led/off)
  *   - Device reset (POST /reset)
+ *   - Packet capture (GET /capture.pcap, GET/POST /capture)
+ *   - Access log (GET /access); each request is recorded as a 20-byte
+ *     binary record rather than as log lines
+ *   - Prometheus metrics (GET /metrics)
  *
  * The esp_http_server component handles:
  *   - TCP connection management
@@ -15,17 +19,34 @@
  *   - Response generation
  */
 
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
 #include "esp_log.h"
 #include "esp_http_server.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
+#include "lwip/sockets.h"
 
 #include "http_server.h"
 #include "log_stream.h"
+#include "cdc_log.h"
 #include "event_log.h"
+#include "static_assets.h"
+#include "access_log.h"
+#include "network_setup.h"
+#if CONFIG_NCM_PCAP_CAPTURE
+#include "pcap_capture.h"
+#endif
 
 #define LED_GPIO 21  // Built-in LED (same as LED_BUILTIN in Arduino)
 #define LED_ON  0    // Active-low: drive LOW to turn on
@@ -34,94 +55,266 @@ static bool s_led_state = false;
 
 static const char *TAG = "http";
 
+#define HTTP_MAX_SOCKETS 7   // httpd default; log streams hold one each
+
 static httpd_handle_t s_server = NULL;
 
-// Request counter for logging
+// Route ids stored in access log records; names for /access and /metrics
+typedef enum {
+    ROUTE_PAGE = 0,
+    ROUTE_LED,
+    ROUTE_LED_ON,
+    ROUTE_LED_OFF,
+    ROUTE_RESET,
+    ROUTE_LOGS_ALL,
+    ROUTE_LOGS_STATS,
+    ROUTE_EVENTS,
+    ROUTE_STATUS,
+    ROUTE_HISTOGRAMS,
+    ROUTE_ACCESS,
+    ROUTE_METRICS,
+    ROUTE_CAPTURE_PCAP,
+    ROUTE_CAPTURE,
+    ROUTE_LOGS,                 // Recorded when the stream is handed over
+    ROUTE_WS,
+    ROUTE_COUNT
+} http_route_t;
+
+static const char *ROUTE_NAMES[ROUTE_COUNT] = {
+    "page",
+    "/led",
+    "/led/on",
+    "/led/off",
+    "/reset",
+    "/logs_all",
+    "/logs/stats",
+    "/events",
+    "/status",
+    "/net/histograms",
+    "/access",
+    "/metrics",
+    "/capture.pcap",
+    "/capture",
+    "/logs",
+    "/ws",
+};
+
+// Per-route totals for /metrics, updated as each response is logged
+typedef struct {
+    uint32_t requests;
+    uint32_t errors;            // Status 400 and up
+    uint64_t bytes;
+    uint64_t latency_sum_us;
+    uint32_t latency_max_us;
+} route_stats_t;
+
+static route_stats_t s_route_stats[ROUTE_COUNT];
+
+// The request being handled. Handlers all run on the one httpd task, so a
+// single in-flight record is enough.
+static access_log_rec_t s_req;
+static int64_t s_req_start_us = 0;
 static uint32_t s_request_count = 0;
 
-// Simple HTML response with inline styles
-static const char *HTML_RESPONSE =
-    "<!DOCTYPE html>"
-    "<html>"
-    "<head>"
-    "<meta charset=\"UTF-8\">"
-    "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
-    "<title>ESP32-S3 USB NCM</title>"
-    "<style>"
-    "body { font-family: -apple-system, BlinkMacSystemFont, sans-serif; "
-    "max-width: 600px; margin: 50px auto; padding: 20px; text-align: center; }"
-    "h1 { color: #333; }"
-    ".success { color: #28a745; font-size: 24px; }"
-    ".info { background: #f8f9fa; padding: 15px; border-radius: 8px; margin: 20px 0; }"
-    "</style>"
-    "</head>"
-    "<body>"
-    "<h1>ESP32-S3 USB NCM Server</h1>"
-    "<p class=\"success\">Connected!</p>"
-    "<div class=\"info\">"
-    "<p>USB Ethernet-over-USB (CDC-NCM) is working.</p>"
-    "<p>Server IP: 192.168.7.1</p>"
-    "</div>"
-    "</body>"
-    "</html>";
-
-/**
- * @brief Log HTTP request details
- */
-static void log_request(httpd_req_t *req, const char *handler_name)
+/**
+ * @brief Start the access log record for a request
+ */
+static void log_request(httpd_req_t *req, http_route_t route)
 {
     s_request_count++;
+    s_req_start_us = esp_timer_get_time();
 
-    // Get client info if available
-    int sockfd = httpd_req_to_sockfd(req);
+    memset(&s_req, 0, sizeof(s_req));
+    s_req.ts_ms = (uint32_t)(s_req_start_us / 1000);
+    s_req.method = (uint8_t)req->method;
+    s_req.route = (uint8_t)route;
+    s_req.sock = (int16_t)httpd_req_to_sockfd(req);
 
+#if CONFIG_HTTP_ACCESS_LOG_VERBOSE
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "+-- HTTP REQUEST #%lu --------------------",
              (unsigned long)s_request_count);
     ESP_LOGI(TAG, "| Method:  %s", http_method_str(req->method));
     ESP_LOGI(TAG, "| URI:     %s", req->uri);
-    ESP_LOGI(TAG, "| Handler: %s", handler_name);
-    ESP_LOGI(TAG, "| Socket:  %d", sockfd);
+    ESP_LOGI(TAG, "| Route:   %s", ROUTE_NAMES[route]);
+    ESP_LOGI(TAG, "| Socket:  %d", s_req.sock);
     ESP_LOGI(TAG, "| Content: %d bytes", req->content_len);
+#endif
 }
 
 /**
- * @brief Log HTTP response
+ * @brief Finish the request's access log record (call once the response is sent)
  */
 static void log_response(int status_code, const char *content_type, size_t body_len)
 {
+    s_req.status = (uint16_t)status_code;
+    s_req.bytes = (uint32_t)body_len;
+    s_req.latency_us = (uint32_t)(esp_timer_get_time() - s_req_start_us);
+    access_log_record(&s_req);
+
+    route_stats_t *rs = &s_route_stats[s_req.route];
+    rs->requests++;
+    if (status_code >= 400) rs->errors++;
+    rs->bytes += body_len;
+    rs->latency_sum_us += s_req.latency_us;
+    if (s_req.latency_us > rs->latency_max_us) rs->latency_max_us = s_req.latency_us;
+
+#if CONFIG_HTTP_ACCESS_LOG_VERBOSE
     ESP_LOGI(TAG, "|");
     ESP_LOGI(TAG, "| Response: %d", status_code);
     ESP_LOGI(TAG, "| Type:     %s", content_type);
     ESP_LOGI(TAG, "| Size:     %zu bytes", body_len);
+    ESP_LOGI(TAG, "| Time:     %lu us", (unsigned long)s_req.latency_us);
     ESP_LOGI(TAG, "+----------------------------------------");
     ESP_LOGI(TAG, "");
+#endif
+}
+
+/**
+ * @brief Copy a request header whole, however long it is
+ * @return The value (free() it), or NULL if absent, empty or out of memory
+ */
+static char *req_header(httpd_req_t *req, const char *field)
+{
+    size_t len = httpd_req_get_hdr_value_len(req, field);
+    if (len == 0) return NULL;
+
+    char *value = malloc(len + 1);
+    if (value && httpd_req_get_hdr_value_str(req, field, value, len + 1) != ESP_OK) {
+        free(value);
+        value = NULL;
+    }
+    return value;
 }
 
 /**
- * @brief Handler for GET /
+ * @brief Step to the next element of a comma-separated header value
  *
- * Serves the main status page. This is the first thing users see
- * when they connect and open http://192.168.7.1/ in their browser.
+ * @param list  Advanced past the element and its comma
+ * @param item  Start of the element, without surrounding whitespace
+ * @return Element length; 0 once the list is exhausted
  */
-static esp_err_t root_handler(httpd_req_t *req)
+static size_t list_next(const char **list, const char **item)
 {
-    log_request(req, "root_handler");
+    const char *s = *list;
+    size_t len = 0;
+
+    while (len == 0 && *s) {
+        s += strspn(s, " \t,");
+        *item = s;
+        s += strcspn(s, ",");
+        len = (size_t)(s - *item);
+        while (len > 0 && ((*item)[len - 1] == ' ' || (*item)[len - 1] == '\t')) len--;
+    }
+    *list = s;
+    return len;
+}
 
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, HTML_RESPONSE, strlen(HTML_RESPONSE));
+/**
+ * @brief If-None-Match check: is etag (quoted) among the listed validators?
+ *
+ * Uses the weak comparison RFC 9110 asks for here, so W/"x" matches "x";
+ * "*" matches anything.
+ */
+static bool etag_listed(const char *list, const char *etag)
+{
+    size_t etag_len = strlen(etag);
+    const char *item;
+    size_t len;
+
+    while ((len = list_next(&list, &item)) > 0) {
+        if (len == 1 && item[0] == '*') return true;
+        if (len > 2 && item[0] == 'W' && item[1] == '/') {
+            item += 2;
+            len -= 2;
+        }
+        if (len == etag_len && memcmp(item, etag, len) == 0) return true;
+    }
+    return false;
+}
 
-    log_response(200, "text/html", strlen(HTML_RESPONSE));
+/**
+ * @brief Accept-Encoding check: may the response be gzip?
+ *
+ * An explicit gzip entry wins over "*"; either is refused by q=0.
+ */
+static bool gzip_accepted(const char *list)
+{
+    int gzip = -1;      // -1 not listed, else 0/1
+    int any = -1;
+    const char *item;
+    size_t len;
+
+    while ((len = list_next(&list, &item)) > 0) {
+        size_t name = 0;
+        while (name < len && item[name] != ';' && item[name] != ' ' && item[name] != '\t') name++;
+
+        bool ok = true;
+        const char *q = memchr(item, ';', len);
+        if (q) {
+            q += 1 + strspn(q + 1, " \t");
+            if ((q[0] == 'q' || q[0] == 'Q') && q[1] == '=') {
+                ok = strtod(q + 2, NULL) > 0;
+            }
+        }
 
-    return ESP_OK;
+        if (name == 4 && strncasecmp(item, "gzip", 4) == 0) {
+            gzip = ok;
+        } else if (name == 1 && item[0] == '*') {
+            any = ok;
+        }
+    }
+    return gzip >= 0 ? gzip : any > 0;
 }
 
-static const httpd_uri_t root_uri = {
-    .uri       = "/",
-    .method    = HTTP_GET,
-    .handler   = root_handler,
-    .user_ctx  = NULL
-};
+/**
+ * @brief Handler for the pages in static_assets[] (GET / and /dashboard)
+ *
+ * Pages are stored gzip-compressed with an ETag computed at build time,
+ * so a request costs no compression or hashing here. A browser that
+ * already has the page revalidates and gets an empty 304. There is no
+ * uncompressed copy: a client whose Accept-Encoding rules gzip out gets
+ * 406, one that sends none gets gzip (curl needs --compressed).
+ */
+static esp_err_t asset_handler(httpd_req_t *req)
+{
+    const static_asset_t *asset = req->user_ctx;
+
+    log_request(req, ROUTE_PAGE);
+
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");   // Always revalidate
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+    char *hdr = req_header(req, "If-None-Match");
+    bool fresh = hdr && etag_listed(hdr, asset->etag);
+    free(hdr);
+    if (fresh) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
+        log_response(304, asset->type, 0);
+        return ESP_OK;
+    }
+
+    hdr = req_header(req, "Accept-Encoding");
+    bool gzip_ok = !hdr || gzip_accepted(hdr);
+    free(hdr);
+    if (!gzip_ok) {
+        const char *msg = "Only gzip is available";
+        httpd_resp_set_status(req, "406 Not Acceptable");
+        httpd_resp_sendstr(req, msg);
+        log_response(406, "text/plain", strlen(msg));
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, asset->type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    httpd_resp_send(req, (const char *)asset->gz, asset->gz_len);
+
+    log_response(200, asset->type, asset->gz_len);
+
+    return ESP_OK;
+}
 
 /**
  * @brief Handler for POST /reset
@@ -131,11 +324,9 @@ static const httpd_uri_t root_uri = {
  */
 static esp_err_t reset_handler(httpd_req_t *req)
 {
-    log_request(req, "reset_handler");
+    log_request(req, ROUTE_RESET);
 
-    ESP_LOGW(TAG, "|");
-    ESP_LOGW(TAG, "| !!! RESET REQUESTED !!!");
-    ESP_LOGW(TAG, "| Device will restart in 100ms");
+    ESP_LOGW(TAG, "Reset requested over HTTP, restarting in 100 ms");
 
     httpd_resp_set_type(req, "application/json");
     const char *response = "{\"status\":\"resetting\"}";
@@ -146,7 +337,6 @@ static esp_err_t reset_handler(httpd_req_t *req)
     // Small delay to let response send before reset
     vTaskDelay(pdMS_TO_TICKS(100));
 
-    ESP_LOGI(TAG, "Calling esp_restart()...");
     esp_restart();
 
     return ESP_OK;  // Never reached
@@ -159,6 +349,15 @@ static const httpd_uri_t reset_uri = {
     .user_ctx  = NULL
 };
 
+static void led_set(bool on)
+{
+    s_led_state = on;
+    gpio_set_level(LED_GPIO, on ? LED_ON : LED_OFF);
+#if CONFIG_HTTP_ACCESS_LOG_VERBOSE
+    ESP_LOGI(TAG, "LED %s (GPIO %d = %s)", on ? "ON" : "OFF", LED_GPIO, on ? "LOW" : "HIGH");
+#endif
+}
+
 /**
  * @brief Handler for POST /led/on
  *
@@ -166,13 +365,9 @@ static const httpd_uri_t reset_uri = {
  */
 static esp_err_t led_on_handler(httpd_req_t *req)
 {
-    log_request(req, "led_on_handler");
-
-    s_led_state = true;
-    gpio_set_level(LED_GPIO, LED_ON);
+    log_request(req, ROUTE_LED_ON);
 
-    ESP_LOGI(TAG, "|");
-    ESP_LOGI(TAG, "| LED STATE: ON (GPIO %d = LOW)", LED_GPIO);
+    led_set(true);
 
     httpd_resp_set_type(req, "application/json");
     const char *response = "{\"led\":true}";
@@ -190,13 +385,9 @@ static esp_err_t led_on_handler(httpd_req_t *req)
  */
 static esp_err_t led_off_handler(httpd_req_t *req)
 {
-    log_request(req, "led_off_handler");
-
-    s_led_state = false;
-    gpio_set_level(LED_GPIO, LED_OFF);
+    log_request(req, ROUTE_LED_OFF);
 
-    ESP_LOGI(TAG, "|");
-    ESP_LOGI(TAG, "| LED STATE: OFF (GPIO %d = HIGH)", LED_GPIO);
+    led_set(false);
 
     httpd_resp_set_type(req, "application/json");
     const char *response = "{\"led\":false}";
@@ -214,10 +405,7 @@ static esp_err_t led_off_handler(httpd_req_t *req)
  */
 static esp_err_t led_status_handler(httpd_req_t *req)
 {
-    log_request(req, "led_status_handler");
-
-    ESP_LOGI(TAG, "|");
-    ESP_LOGI(TAG, "| Current LED state: %s", s_led_state ? "ON" : "OFF");
+    log_request(req, ROUTE_LED);
 
     httpd_resp_set_type(req, "application/json");
     const char *response = s_led_state ? "{\"led\":true}" : "{\"led\":false}";
@@ -250,212 +438,1171 @@ static const httpd_uri_t led_status_uri = {
 };
 
 /**
- * @brief Handler for GET /logs - Server-Sent Events log stream
+ * @brief Decode %XX escapes and '+' in a query value, in place
+ */
+static void url_decode(char *s)
+{
+    char *out = s;
+    while (*s) {
+        if (*s == '%' && isxdigit((unsigned char)s[1]) && isxdigit((unsigned char)s[2])) {
+            char hex[3] = { s[1], s[2], '\0' };
+            *out++ = (char)strtoul(hex, NULL, 16);
+            s += 3;
+        } else {
+            *out++ = (*s == '+') ? ' ' : *s;
+            s++;
+        }
+    }
+    *out = '\0';
+}
+
+#define LOG_QUERY_MAX 192   // Query string of /logs and /logs_all
+
+/**
+ * @brief Copy the query string of a log endpoint, for parsing once
  *
- * Streams logs in real-time using SSE format:
- *   data: log line here\n\n
+ * A query that doesn't fit is refused rather than cut short: httpd would
+ * drop whatever parameters come last (the dashboard puts since= there).
  *
- * iOS Usage with URLSession:
- *   let url = URL(string: "http://192.168.7.1/logs")!
- *   let task = URLSession.shared.dataTask(with: url) { data, _, _ in
- *       if let data = data, let line = String(data: data, encoding: .utf8) {
- *           // Parse SSE: lines starting with "data: "
- *       }
- *   }
- *   task.resume()
+ * @param query  LOG_QUERY_MAX bytes; empty if the URI has no query
+ * @return false if the query is too long (answer 400)
+ */
+static bool log_query(httpd_req_t *req, char *query)
+{
+    query[0] = '\0';
+    if (httpd_req_get_url_query_len(req) >= LOG_QUERY_MAX) {
+        return false;
+    }
+    if (httpd_req_get_url_query_str(req, query, LOG_QUERY_MAX) != ESP_OK) {
+        query[0] = '\0';
+    }
+    return true;
+}
+
+/**
+ * @brief Build a log filter from the query string (see log_query())
  *
- * Or use a proper EventSource library for Swift.
+ *   level=W (or level>=W)   W and more severe: E, W, I, D, V
+ *   tag=net,http            Any of these tags (up to LOG_FILTER_MAX_TAGS)
+ *   grep=text               Lines containing text
+ *
+ * @return true if any filter parameter was given
  */
-static esp_err_t logs_sse_handler(httpd_req_t *req)
+static bool parse_log_filter(const char *query, log_filter_t *filter)
 {
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "+-- SSE LOG STREAM STARTED -------------");
-    ESP_LOGI(TAG, "| Client connected for log streaming");
+    static const char *level_keys[] = { "level", "level>", "level%3E", "level%3e" };
+    char val[LOG_FILTER_GREP_LEN * 3];  // Room for a percent-encoded grep
 
-    // Allocate a reader slot
-    int reader_id = log_buffer_alloc_reader();
-    if (reader_id < 0) {
-        ESP_LOGW(TAG, "| No reader slots available (max 4 clients)");
-        ESP_LOGI(TAG, "+----------------------------------------");
-        httpd_resp_set_status(req, "503 Service Unavailable");
-        httpd_resp_sendstr(req, "Too many log clients (max 4)");
-        return ESP_FAIL;
+    memset(filter, 0, sizeof(*filter));
+    if (query[0] == '\0') {
+        return false;
     }
 
-    ESP_LOGI(TAG, "| Allocated reader ID: %d", reader_id);
-    ESP_LOGI(TAG, "+----------------------------------------");
+    for (size_t i = 0; i < sizeof(level_keys) / sizeof(level_keys[0]); i++) {
+        if (httpd_query_key_value(query, level_keys[i], val, sizeof(val)) == ESP_OK) {
+            const char *levels = "EWIDV";
+            const char *l = val[0] ? strchr(levels, toupper((unsigned char)val[0])) : NULL;
+            if (l) {
+                filter->max_level = (uint8_t)(l - levels + 1);
+            }
+            break;
+        }
+    }
 
-    // Set SSE headers
-    httpd_resp_set_type(req, "text/event-stream");
-    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
-    httpd_resp_set_hdr(req, "Connection", "keep-alive");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    if (httpd_query_key_value(query, "tag", val, sizeof(val)) == ESP_OK) {
+        url_decode(val);
+        char *save;
+        for (char *tok = strtok_r(val, ",", &save); tok && filter->tag_count < LOG_FILTER_MAX_TAGS;
+             tok = strtok_r(NULL, ",", &save)) {
+            snprintf(filter->tags[filter->tag_count++], LOG_FILTER_TAG_LEN, "%s", tok);
+        }
+    }
 
-    // Send initial comment to establish connection
-    const char *init_msg = ": ESP32 log stream connected\n\n";
-    if (httpd_resp_send_chunk(req, init_msg, strlen(init_msg)) != ESP_OK) {
-        log_buffer_free_reader(reader_id);
-        return ESP_FAIL;
+    if (httpd_query_key_value(query, "grep", val, sizeof(val)) == ESP_OK) {
+        url_decode(val);
+        snprintf(filter->grep, sizeof(filter->grep), "%s", val);
     }
 
-    // Stream logs until client disconnects
-    char sse_buf[300];  // "data: " + log line + "\n\n"
-    int idle_count = 0;
-    const int MAX_IDLE = 100;  // Send keepalive after this many empty polls
+    return filter->max_level || filter->tag_count || filter->grep[0];
+}
 
-    while (1) {
-        size_t log_len;
-        const char *log_line = log_buffer_read(reader_id, &log_len);
+#define SSE_LINE_TEXT    256   // Longest log line
+#define SSE_EVENT_MAX    360   // Gap event + "id:" + "data: " + longest line + "\n\n"
+#define STREAM_KEEPALIVE_MS 5000   // Keepalive to detect a dead client
+#define STREAM_STALL_POLL_MS 20    // Retry a client whose socket is full
+#define STREAM_TASK_STACK 4096
+#define STREAM_TASK_PRIORITY 4     // Below the httpd task, so requests go first
+#define WS_EVENT_POLL_MS 100       // Event log has no wakeup; check this often
 
-        if (log_line && log_len > 0) {
-            idle_count = 0;
+/**
+ * @brief Get the id of the last event a reconnecting client saw
+ *
+ * EventSource sends it as Last-Event-ID; ?since=<id> is the same for
+ * clients that can't set headers.
+ */
+static bool sse_resume_id(httpd_req_t *req, const char *query, uint64_t *last_id)
+{
+    char val[24];
+    bool found = false;
 
-            // Format as SSE: "data: <log>\n\n"
-            int sse_len = snprintf(sse_buf, sizeof(sse_buf), "data: %.*s\n\n",
-                                   (int)log_len, log_line);
+    if (httpd_req_get_hdr_value_str(req, "Last-Event-ID", val, sizeof(val)) == ESP_OK) {
+        found = true;
+    } else if (httpd_query_key_value(query, "since", val, sizeof(val)) == ESP_OK) {
+        found = true;
+    }
+    if (!found) {
+        return false;
+    }
 
-            if (httpd_resp_send_chunk(req, sse_buf, sse_len) != ESP_OK) {
-                // Client disconnected
-                break;
-            }
-        } else {
-            idle_count++;
-
-            // Send keepalive comment periodically to detect disconnect
-            if (idle_count >= MAX_IDLE) {
-                idle_count = 0;
-                if (httpd_resp_send_chunk(req, ": keepalive\n\n", 13) != ESP_OK) {
-                    break;
-                }
-            }
+    char *end;
+    unsigned long long id = strtoull(val, &end, 10);
+    if (end == val || *end != '\0') {
+        return false;
+    }
+    *last_id = id;
+    return true;
+}
 
-            // Small delay when no data
-            vTaskDelay(pdMS_TO_TICKS(50));
+/**
+ * @brief Append pending lines to an SSE chunk as "id:"/"data:" events
+ *
+ * A line that follows lost lines is preceded by a "gap" event naming the
+ * first lost id and how many were lost.
+ *
+ * @return New chunk length
+ */
+static size_t sse_append_lines(int reader_id, char *batch, size_t len, char *line)
+{
+    log_line_t ln;
+
+    while (len + SSE_EVENT_MAX <= CONFIG_LOG_SSE_BATCH_BYTES &&
+           log_buffer_read_lines(reader_id, &ln, 1, line, SSE_LINE_TEXT) > 0) {
+        if (ln.gap) {
+            len += snprintf(batch + len, CONFIG_LOG_SSE_BATCH_BYTES - len,
+                            "event: gap\ndata: {\"from\":%llu,\"lost\":%lu}\n\n",
+                            (unsigned long long)(ln.seq - ln.gap), (unsigned long)ln.gap);
         }
+        len += snprintf(batch + len, CONFIG_LOG_SSE_BATCH_BYTES - len, "id: %llu\ndata: %.*s\n\n",
+                        (unsigned long long)ln.seq, (int)ln.len, line);
     }
+    return len;
+}
+
+/**
+ * @brief A streaming client served by the broadcaster task
+ *
+ * For SSE, req is the copy from httpd_req_async_handler_begin(): httpd
+ * keeps the socket open and leaves it to us until
+ * httpd_req_async_handler_complete(). A WebSocket client is addressed by
+ * its fd and session token (ws_session_token()); httpd goes on reading
+ * its frames (ws_handler()).
+ */
+typedef struct {
+    bool used;
+    bool ws;                    // WebSocket (binary frames) rather than SSE
+    bool events;                // WS: push event log records
+    int fd;
+    uint32_t session;           // WS: token of the session on fd
+    httpd_req_t *req;           // SSE only
+    int reader_id;              // -1: WS client not subscribed to logs
+    size_t events_sent;         // WS: event log records pushed so far
+    char *batch;                // Pending events, then SSE_LINE_TEXT of scratch
+    size_t len;                 // Bytes pending in batch
+    TickType_t first;           // When the oldest pending event was read
+    TickType_t last_send;
+} stream_client_t;
+
+typedef enum {
+    STREAM_ADD,                 // New client
+    STREAM_SUBSCRIBE,           // WS client changed reader_id/events
+    STREAM_CLOSED,              // httpd closed this fd
+} stream_op_t;
+
+typedef struct {
+    stream_op_t op;
+    stream_client_t client;
+} stream_msg_t;
+
+// Every client holds a socket, so the table never needs more slots
+static stream_client_t s_streams[HTTP_MAX_SOCKETS];
+static QueueHandle_t s_stream_queue = NULL;     // httpd task -> broadcaster
+static TaskHandle_t s_stream_task = NULL;
+
+#if CONFIG_HTTPD_WS_SUPPORT
+/*
+ * lwIP gives a closed fd number to the next accept, so the fd alone can
+ * name a different connection by the time the broadcaster uses it. Each
+ * WebSocket session gets a token in its httpd session context;
+ * stream_sock_closed() clears it under s_ws_lock before the socket is
+ * closed. A client whose token no longer matches is gone: nothing is sent
+ * to its fd and the session now on that fd is left alone.
+ */
+static SemaphoreHandle_t s_ws_lock = NULL;  // Sends, and token checks vs close
+static uint32_t s_ws_sessions = 0;          // Last token handed out (httpd task)
 
-    // Cleanup
-    log_buffer_free_reader(reader_id);
+static void ws_session_free(void *ctx)
+{
+    (void)ctx;                  // A token, not memory
+}
 
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "+-- SSE LOG STREAM ENDED ---------------");
-    ESP_LOGI(TAG, "| Reader %d disconnected", reader_id);
-    ESP_LOGI(TAG, "+----------------------------------------");
+// 0 for a socket that is not (or no longer) one of our WS sessions
+static inline uint32_t ws_session_token(int fd)
+{
+    return (uint32_t)(uintptr_t)httpd_sess_get_ctx(s_server, fd);
+}
+#endif
 
-    // End chunked response
-    httpd_resp_send_chunk(req, NULL, 0);
+// True if a send won't block: a client that stopped reading is skipped
+// (and eventually lapped by the ring) instead of holding up the others
+static bool stream_writable(int fd)
+{
+    fd_set wfds;
+    struct timeval tv = { 0 };
 
-    return ESP_OK;
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    return select(fd + 1, NULL, &wfds, NULL, &tv) > 0;
 }
 
-static const httpd_uri_t logs_sse_uri = {
-    .uri       = "/logs",
-    .method    = HTTP_GET,
-    .handler   = logs_sse_handler,
-    .user_ctx  = NULL
-};
+// Pass a client change to the broadcaster and wake it
+static bool stream_post(stream_op_t op, const stream_client_t *client)
+{
+    stream_msg_t msg = { .op = op, .client = *client };
+    if (xQueueSend(s_stream_queue, &msg, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return false;
+    }
+    log_buffer_wake_any();
+    return true;
+}
 
-/**
- * @brief Handler for GET /logs_all - Static log dump
- *
- * Returns all buffered logs as plain text (not SSE).
- * Useful for viewing logs from before connecting to the stream.
- */
-static esp_err_t logs_all_handler(httpd_req_t *req)
+static stream_client_t *stream_find_ws(int fd, uint32_t session)
 {
-    ESP_LOGI(TAG, "");
-    ESP_LOGI(TAG, "+-- LOGS_ALL REQUEST -------------------");
+    for (int i = 0; i < HTTP_MAX_SOCKETS; i++) {
+        if (s_streams[i].used && s_streams[i].ws && s_streams[i].fd == fd &&
+            s_streams[i].session == session) {
+            return &s_streams[i];
+        }
+    }
+    return NULL;
+}
 
-    int line_count = log_buffer_get_count();
-    ESP_LOGI(TAG, "| Returning %d buffered log lines", line_count);
+static void stream_release(stream_client_t *c)
+{
+    if (c->reader_id >= 0) {
+        log_buffer_free_reader(c->reader_id);
+    }
+    free(c->batch);
+    memset(c, 0, sizeof(*c));
+}
 
-    // Allocate buffer for all logs (200 lines * 256 bytes max = 51KB)
-    #define LOG_DUMP_SIZE 65536
-    char *chunk = malloc(LOG_DUMP_SIZE);
-    if (!chunk) {
-        ESP_LOGE(TAG, "| malloc failed for log buffer");
-        ESP_LOGI(TAG, "+----------------------------------------");
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+// The client's send failed: drop it and have httpd close the socket
+static void stream_close(stream_client_t *c)
+{
+    httpd_handle_t hd = s_server;
+
+#if CONFIG_HTTP_ACCESS_LOG_VERBOSE
+    ESP_LOGI(TAG, "%s stream fd %d ended (reader %d)", c->ws ? "WS" : "SSE", c->fd, c->reader_id);
+#endif
+
+#if CONFIG_HTTPD_WS_SUPPORT
+    if (c->ws) {
+        // Only if the socket still belongs to this client
+        xSemaphoreTake(s_ws_lock, portMAX_DELAY);
+        if (ws_session_token(c->fd) == c->session) {
+            httpd_sess_trigger_close(hd, c->fd);
+        }
+        xSemaphoreGive(s_ws_lock);
+        stream_release(c);
+        return;
     }
+#endif
 
-    httpd_resp_set_type(req, "text/plain; charset=utf-8");
-    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    if (c->req) {
+        // Release the request before the session it points into goes away
+        hd = c->req->handle;
+        httpd_req_async_handler_complete(c->req);
+    }
+    httpd_sess_trigger_close(hd, c->fd);
+    stream_release(c);
+}
+
+// Apply a change posted by the httpd task
+static void stream_apply(const stream_msg_t *msg)
+{
+    const stream_client_t *in = &msg->client;
+    stream_client_t *c = in->ws ? stream_find_ws(in->fd, in->session) : NULL;
+
+    switch (msg->op) {
+    case STREAM_ADD:
+        for (int i = 0; i < HTTP_MAX_SOCKETS; i++) {
+            if (!s_streams[i].used) {
+                s_streams[i] = *in;
+                s_streams[i].used = true;
+                return;
+            }
+        }
+        // Can't happen (one slot per socket), but don't leak the session
+        stream_client_t lost = *in;
+        stream_close(&lost);
+        return;
+
+    case STREAM_SUBSCRIBE:
+        if (!c) {
+            // Closed meanwhile
+            if (in->reader_id >= 0) {
+                log_buffer_free_reader(in->reader_id);
+            }
+            return;
+        }
+        if (c->reader_id >= 0) {
+            log_buffer_free_reader(c->reader_id);
+        }
+        c->reader_id = in->reader_id;
+        c->len = 0;             // Pending lines came from the old reader
+        if (in->events && !c->events) {
+            c->events_sent = 0;
+        }
+        c->events = in->events;
+        return;
+
+    case STREAM_CLOSED:
+        if (c) {
+#if CONFIG_HTTP_ACCESS_LOG_VERBOSE
+            ESP_LOGI(TAG, "WS stream fd %d closed (reader %d)", c->fd, c->reader_id);
+#endif
+            stream_release(c);
+        }
+        return;
+    }
+}
 
-    // Get all logs
-    size_t total_len = log_buffer_get_all(chunk, LOG_DUMP_SIZE);
+#if CONFIG_HTTPD_WS_SUPPORT
+static esp_err_t ws_send(int fd, uint32_t session, httpd_ws_type_t type,
+                         const void *data, size_t len);
+static size_t ws_append_lines(int reader_id, char *batch, size_t len, char *line);
+static esp_err_t ws_push_events(stream_client_t *c);
+#endif
 
-    if (total_len > 0) {
-        httpd_resp_send(req, chunk, total_len);
-    } else {
-        const char *empty_msg = "(no logs in buffer)\n";
-        httpd_resp_send(req, empty_msg, strlen(empty_msg));
+static size_t stream_append(stream_client_t *c, char *line)
+{
+    if (c->reader_id < 0) return c->len;
+#if CONFIG_HTTPD_WS_SUPPORT
+    if (c->ws) {
+        return ws_append_lines(c->reader_id, c->batch, c->len, line);
     }
+#endif
+    return sse_append_lines(c->reader_id, c->batch, c->len, line);
+}
 
-    ESP_LOGI(TAG, "| Sent %zu bytes", total_len);
-    ESP_LOGI(TAG, "+----------------------------------------");
+static esp_err_t stream_send(stream_client_t *c, const char *data, size_t len)
+{
+#if CONFIG_HTTPD_WS_SUPPORT
+    if (c->ws) {
+        return ws_send(c->fd, c->session, HTTPD_WS_TYPE_BINARY, data, len);
+    }
+#endif
+    return httpd_resp_send_chunk(c->req, data, len);
+}
 
-    free(chunk);
-    return ESP_OK;
+// Also how a dead client is noticed while nothing is logged
+static esp_err_t stream_keepalive(stream_client_t *c)
+{
+#if CONFIG_HTTPD_WS_SUPPORT
+    if (c->ws) {
+        return ws_send(c->fd, c->session, HTTPD_WS_TYPE_PING, NULL, 0);
+    }
+#endif
+    static const char keepalive[] = ": keepalive\n\n";
+    return httpd_resp_send_chunk(c->req, keepalive, sizeof(keepalive) - 1);
 }
 
-static const httpd_uri_t logs_all_uri = {
-    .uri       = "/logs_all",
-    .method    = HTTP_GET,
-    .handler   = logs_all_handler,
-    .user_ctx  = NULL
-};
+static inline void stream_due(TickType_t *wait, TickType_t due)
+{
+    if (due < *wait) *wait = due;
+}
 
 /**
- * @brief Handler for GET /events - Critical events (sticky, never truncated)
+ * @brief Read new lines into a client's batch and send it once it is due
+ *
+ * A batch goes out when it is full or CONFIG_LOG_SSE_FLUSH_MS after its
+ * first line; an idle client gets a keepalive every STREAM_KEEPALIVE_MS.
+ *
+ * @param wait   In/out: lowered to when this client next needs service
+ * @param watch  Output: wake the broadcaster when this reader gets data
+ * @return false if the client is gone
  */
-static esp_err_t events_handler(httpd_req_t *req)
+static bool stream_service(stream_client_t *c, TickType_t now, TickType_t *wait, bool *watch)
 {
-    #define EVENTS_BUF_SIZE 4096
-    char *buf = malloc(EVENTS_BUF_SIZE);
-    if (!buf) {
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+    char *line = c->batch + CONFIG_LOG_SSE_BATCH_BYTES;
+    size_t had = c->len;
+
+#if CONFIG_HTTPD_WS_SUPPORT
+    if (c->ws && c->events) {
+        // Event records are rare: poll for them, send them at once
+        if (event_log_count() > c->events_sent) {
+            if (!stream_writable(c->fd)) {
+                stream_due(wait, pdMS_TO_TICKS(STREAM_STALL_POLL_MS));
+                return true;
+            }
+            if (ws_push_events(c) != ESP_OK) {
+                return false;
+            }
+            c->last_send = now;
+        }
+        stream_due(wait, pdMS_TO_TICKS(WS_EVENT_POLL_MS));
     }
+#endif
 
-    httpd_resp_set_type(req, "text/plain; charset=utf-8");
-    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    c->len = stream_append(c, line);
+    if (had == 0 && c->len > 0) {
+        c->first = now;
+    }
+    *watch = c->reader_id >= 0;
 
-    size_t len = event_log_get_all(buf, EVENTS_BUF_SIZE);
-    httpd_resp_send(req, buf, len);
+    if (c->len == 0) {
+        TickType_t idle = now - c->last_send;
+        if (idle < pdMS_TO_TICKS(STREAM_KEEPALIVE_MS)) {
+            stream_due(wait, pdMS_TO_TICKS(STREAM_KEEPALIVE_MS) - idle);
+            return true;
+        }
+        if (!stream_writable(c->fd)) {
+            stream_due(wait, pdMS_TO_TICKS(STREAM_STALL_POLL_MS));
+            return true;
+        }
+        if (stream_keepalive(c) != ESP_OK) {
+            return false;
+        }
+        c->last_send = now;
+        stream_due(wait, pdMS_TO_TICKS(STREAM_KEEPALIVE_MS));
+        return true;
+    }
 
-    free(buf);
-    return ESP_OK;
-}
+    // Give a burst up to the flush interval to fill the batch
+    if (c->len + SSE_EVENT_MAX <= CONFIG_LOG_SSE_BATCH_BYTES &&
+        now - c->first < pdMS_TO_TICKS(CONFIG_LOG_SSE_FLUSH_MS)) {
+        stream_due(wait, pdMS_TO_TICKS(CONFIG_LOG_SSE_FLUSH_MS) - (now - c->first));
+        return true;
+    }
 
-static const httpd_uri_t events_uri = {
-    .uri       = "/events",
-    .method    = HTTP_GET,
-    .handler   = events_handler,
-    .user_ctx  = NULL
-};
+    if (!stream_writable(c->fd)) {
+        *watch = false;         // Batch is full or due; new lines can wait
+        stream_due(wait, pdMS_TO_TICKS(STREAM_STALL_POLL_MS));
+        return true;
+    }
+
+    if (stream_send(c, c->batch, c->len) != ESP_OK) {
+        return false;
+    }
+    log_buffer_mark_delivered(c->reader_id, c->len);
+    c->len = 0;
+    c->last_send = now;
+
+    // More may be pending already
+    *wait = 0;
+    return true;
+}
 
 /**
- * @brief Handler for GET /status - JSON with event flags
+ * @brief Broadcaster: streams every SSE and WebSocket client from one task
+ *
+ * Sleeps until a watched reader gets a line or some client's flush,
+ * keepalive or stall-retry time comes up.
  */
-static esp_err_t status_handler(httpd_req_t *req)
+static void stream_task(void *arg)
 {
-    #define STATUS_BUF_SIZE 1024
-    char *buf = malloc(STATUS_BUF_SIZE);
-    if (!buf) {
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
+    int watched[HTTP_MAX_SOCKETS];
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    for (;;) {
+        stream_msg_t msg;
+        while (xQueueReceive(s_stream_queue, &msg, 0) == pdTRUE) {
+            stream_apply(&msg);
+        }
 
-    size_t len = event_log_get_status_json(buf, STATUS_BUF_SIZE);
-    httpd_resp_send(req, buf, len);
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = pdMS_TO_TICKS(STREAM_KEEPALIVE_MS);
+        size_t count = 0;
 
-    free(buf);
-    return ESP_OK;
-}
+        for (int i = 0; i < HTTP_MAX_SOCKETS; i++) {
+            stream_client_t *c = &s_streams[i];
+            if (!c->used) continue;
+
+            bool watch = false;
+            if (!stream_service(c, now, &wait, &watch)) {
+                stream_close(c);
+                continue;
+            }
+            if (watch) {
+                watched[count++] = c->reader_id;
+            }
+        }
+
+        if (wait > 0) {
+            log_buffer_wait_any(watched, count, pdTICKS_TO_MS(wait));
+        }
+    }
+}
+
+/**
+ * @brief httpd close_fn: forget a WebSocket client whose socket is closing
+ */
+static void stream_sock_closed(httpd_handle_t hd, int sockfd)
+{
+#if CONFIG_HTTPD_WS_SUPPORT
+    if (httpd_ws_get_fd_info(hd, sockfd) == HTTPD_WS_CLIENT_WEBSOCKET) {
+        // Retire the token before the fd number can be handed out again
+        xSemaphoreTake(s_ws_lock, portMAX_DELAY);
+        stream_client_t c = {
+            .ws = true,
+            .fd = sockfd,
+            .session = ws_session_token(sockfd),
+            .reader_id = -1,
+        };
+        httpd_sess_set_ctx(hd, sockfd, NULL, NULL);
+        xSemaphoreGive(s_ws_lock);
+        stream_post(STREAM_CLOSED, &c);
+    }
+#endif
+    close(sockfd);
+}
+
+/**
+ * @brief Handler for GET /logs - Server-Sent Events log stream
+ *
+ * Streams logs in real-time using SSE format:
+ *   id: <sequence number>\ndata: log line here\n\n
+ *
+ * The handler only sets the stream up. It then hands the connection to
+ * the broadcaster task (stream_task()) and returns, so open streams never
+ * hold up the server's other requests.
+ *
+ * Pending lines are sent together: each chunk carries as many events as
+ * fit in CONFIG_LOG_SSE_BATCH_BYTES, collected for at most
+ * CONFIG_LOG_SSE_FLUSH_MS after the first one.
+ *
+ * A new client gets every buffered line. A reconnecting one (Last-Event-ID
+ * header, or /logs?since=<id>) resumes with the line after that id.
+ *
+ * ?level=W, ?tag=net,http and ?grep=text (see parse_log_filter()) limit
+ * the stream to matching lines; ids stay the global sequence numbers.
+ *
+ * If lines were lost (the client fell a full buffer behind, or resumed
+ * after they were overwritten), an event before the next line says so:
+ *   event: gap\ndata: {"from":<first lost id>,"lost":<count>}\n\n
+ *
+ * iOS Usage with URLSession:
+ *   let url = URL(string: "http://192.168.7.1/logs")!
+ *   let task = URLSession.shared.dataTask(with: url) { data, _, _ in
+ *       if let data = data, let line = String(data: data, encoding: .utf8) {
+ *           // Parse SSE: lines starting with "data: "
+ *       }
+ *   }
+ *   task.resume()
+ *
+ * Or use a proper EventSource library for Swift.
+ */
+static esp_err_t logs_sse_handler(httpd_req_t *req)
+{
+    log_request(req, ROUTE_LOGS);
+
+    char query[LOG_QUERY_MAX];
+    if (!log_query(req, query)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "query too long");
+        log_response(400, "text/plain", 0);
+        return ESP_FAIL;
+    }
+
+    // Allocate a reader slot
+    int reader_id = log_buffer_alloc_reader("sse");
+    if (reader_id < 0) {
+        ESP_LOGW(TAG, "No log reader for /logs (max %d readers, or out of heap)",
+                 CONFIG_LOG_MAX_READERS);
+        const char *busy = "Too many log clients";
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, busy);
+        log_response(503, "text/plain", strlen(busy));
+        return ESP_FAIL;
+    }
+
+    log_filter_t filter;
+    if (parse_log_filter(query, &filter)) {
+        log_buffer_set_filter(reader_id, &filter);
+    }
+
+    uint64_t last_id;
+    bool resumed = sse_resume_id(req, query, &last_id);
+    bool complete = resumed ? log_buffer_seek(reader_id, last_id + 1) : true;
+
+#if CONFIG_HTTP_ACCESS_LOG_VERBOSE
+    ESP_LOGI(TAG, "| Reader:   %d", reader_id);
+    if (filter.max_level || filter.tag_count || filter.grep[0]) {
+        ESP_LOGI(TAG, "| Filter:   max level %d, %d tag(s), grep \"%s\"",
+                 filter.max_level, filter.tag_count, filter.grep);
+    }
+    if (resumed) {
+        ESP_LOGI(TAG, "| Resume:   after id %llu%s", (unsigned long long)last_id,
+                 complete ? "" : " (some lines lost)");
+    }
+#else
+    (void)complete;
+#endif
+
+    // Set SSE headers
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "Connection", "keep-alive");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    // Send initial comment to establish connection
+    const char *init_msg = ": ESP32 log stream connected\n\n";
+    if (httpd_resp_send_chunk(req, init_msg, strlen(init_msg)) != ESP_OK) {
+        log_buffer_free_reader(reader_id);
+        log_response(499, "text/event-stream", 0);
+        return ESP_FAIL;
+    }
+
+    // Hand the connection to the broadcaster; the socket stays open
+    stream_client_t c = {
+        .reader_id = reader_id,
+        .fd = httpd_req_to_sockfd(req),
+        .batch = malloc(CONFIG_LOG_SSE_BATCH_BYTES + SSE_LINE_TEXT),
+        .last_send = xTaskGetTickCount(),
+    };
+    if (!c.batch || httpd_req_async_handler_begin(req, &c.req) != ESP_OK) {
+        free(c.batch);
+        log_buffer_free_reader(reader_id);
+        log_response(500, "text/event-stream", strlen(init_msg));
+        return ESP_FAIL;
+    }
+    if (!stream_post(STREAM_ADD, &c)) {
+        httpd_req_async_handler_complete(c.req);
+        free(c.batch);
+        log_buffer_free_reader(reader_id);
+        log_response(500, "text/event-stream", strlen(init_msg));
+        return ESP_FAIL;
+    }
+
+    // The stream itself is the broadcaster's; the record covers the setup
+    log_response(200, "text/event-stream", strlen(init_msg));
+    return ESP_OK;
+}
+
+static const httpd_uri_t logs_sse_uri = {
+    .uri       = "/logs",
+    .method    = HTTP_GET,
+    .handler   = logs_sse_handler,
+    .user_ctx  = NULL
+};
+
+#if CONFIG_HTTPD_WS_SUPPORT
+/*
+ * GET /ws - WebSocket carrying log lines, event records and commands
+ *
+ * One persistent connection replaces polling /status and /led and the
+ * /logs text stream. All frames are binary, integers little-endian.
+ *
+ * Client -> device: [op][tag][args]. tag is echoed in the reply so
+ * requests can be pipelined.
+ *   0x10 PING       any bytes (up to 16), echoed back
+ *   0x11 LED        [on]
+ *   0x12 STATUS     (none)
+ *   0x13 RESET      (none); the reply is sent, then the device restarts
+ *   0x14 SUBSCRIBE  [mask: bit0 logs, bit1 events][max_level][since u64]?
+ *                   max_level 0 = all; since = first seq wanted, default
+ *                   the oldest buffered line. mask 0 stops both.
+ *
+ * Device -> client:
+ *   0x80|op REPLY   [tag][status: 0 ok, 1 bad request, 2 no reader][data]
+ *                   LED: [on]  STATUS: [event flags u32][led][head seq u64]
+ *   0x01 LOGS       records of [seq u64][ts_us u32][gap u32][len u16][text]
+ *   0x02 EVENTS     records of [ts_ms u32][event_type_t u8][len u8][detail]
+ *
+ * Replies are sent from the httpd task; log and event pushes from the
+ * broadcaster. ws_send() serializes the two.
+ */
+#define WS_OP_PING          0x10
+#define WS_OP_LED           0x11
+#define WS_OP_STATUS        0x12
+#define WS_OP_RESET         0x13
+#define WS_OP_SUBSCRIBE     0x14
+#define WS_REPLY            0x80
+#define WS_MSG_LOGS         0x01
+#define WS_MSG_EVENTS       0x02
+
+#define WS_OK               0
+#define WS_ERR_REQUEST      1
+#define WS_ERR_NO_READER    2
+
+#define WS_SUB_LOGS         0x01
+#define WS_SUB_EVENTS       0x02
+
+#define WS_RX_MAX           32      // Largest command accepted
+#define WS_PING_MAX         16
+#define WS_LINE_HDR         18      // seq + ts_us + gap + len
+#define WS_EVENT_BATCH      8       // Event records per frame
+
+// Fails without sending once the session is closed (see ws_session_token())
+static esp_err_t ws_send(int fd, uint32_t session, httpd_ws_type_t type,
+                         const void *data, size_t len)
+{
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = type,
+        .payload = (uint8_t *)data,
+        .len = len,
+    };
+
+    xSemaphoreTake(s_ws_lock, portMAX_DELAY);
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    if (session != 0 && ws_session_token(fd) == session) {
+        ret = httpd_ws_send_frame_async(s_server, fd, &frame);
+    }
+    xSemaphoreGive(s_ws_lock);
+    return ret;
+}
+
+static inline size_t put_le(char *dst, uint64_t v, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        dst[i] = (char)(v >> (8 * i));
+    }
+    return bytes;
+}
+
+/**
+ * @brief Append pending lines to a LOGS frame
+ *
+ * @return New frame length (0 while nothing is pending)
+ */
+static size_t ws_append_lines(int reader_id, char *batch, size_t len, char *line)
+{
+    log_line_t ln;
+    size_t start = len;
+
+    if (len == 0) {
+        batch[len++] = WS_MSG_LOGS;
+    }
+    while (len + WS_LINE_HDR + SSE_LINE_TEXT <= CONFIG_LOG_SSE_BATCH_BYTES &&
+           log_buffer_read_lines(reader_id, &ln, 1, line, SSE_LINE_TEXT) > 0) {
+        len += put_le(batch + len, ln.seq, 8);
+        len += put_le(batch + len, ln.ts_us, 4);
+        len += put_le(batch + len, ln.gap, 4);
+        len += put_le(batch + len, ln.len, 2);
+        memcpy(batch + len, line, ln.len);
+        len += ln.len;
+    }
+    return (start == 0 && len == 1) ? 0 : len;
+}
+
+// Send the event records this client hasn't seen
+static esp_err_t ws_push_events(stream_client_t *c)
+{
+    event_log_entry_t ev[WS_EVENT_BATCH];
+    char frame[1 + WS_EVENT_BATCH * (6 + EVENT_LOG_DETAIL_LEN)];
+    size_t n;
+
+    while ((n = event_log_read(c->events_sent, ev, WS_EVENT_BATCH)) > 0) {
+        size_t len = 0;
+        frame[len++] = WS_MSG_EVENTS;
+        for (size_t i = 0; i < n; i++) {
+            size_t dlen = strnlen(ev[i].detail, EVENT_LOG_DETAIL_LEN);
+            len += put_le(frame + len, ev[i].timestamp_ms, 4);
+            frame[len++] = (char)ev[i].type;
+            frame[len++] = (char)dlen;
+            memcpy(frame + len, ev[i].detail, dlen);
+            len += dlen;
+        }
+        esp_err_t ret = ws_send(c->fd, c->session, HTTPD_WS_TYPE_BINARY, frame, len);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        c->events_sent += n;
+    }
+    return ESP_OK;
+}
+
+// Start, change or stop what is pushed to this connection
+static uint8_t ws_subscribe(int fd, const uint8_t *args, size_t len)
+{
+    if (len < 2 || (len != 2 && len != 10)) {
+        return WS_ERR_REQUEST;
+    }
+
+    stream_client_t c = {
+        .ws = true,
+        .fd = fd,
+        .session = ws_session_token(fd),
+        .reader_id = -1,
+        .events = (args[0] & WS_SUB_EVENTS) != 0,
+    };
+
+    if (args[0] & WS_SUB_LOGS) {
+        c.reader_id = log_buffer_alloc_reader("ws");
+        if (c.reader_id < 0) {
+            return WS_ERR_NO_READER;
+        }
+        if (args[1]) {
+            log_filter_t filter = { .max_level = args[1] };
+            log_buffer_set_filter(c.reader_id, &filter);
+        }
+        if (len == 10) {
+            uint64_t since = 0;
+            for (int i = 7; i >= 0; i--) {
+                since = (since << 8) | args[2 + i];
+            }
+            log_buffer_seek(c.reader_id, since);
+        }
+    }
+
+    if (!stream_post(STREAM_SUBSCRIBE, &c)) {
+        if (c.reader_id >= 0) {
+            log_buffer_free_reader(c.reader_id);
+        }
+        return WS_ERR_NO_READER;
+    }
+    return WS_OK;
+}
+
+/**
+ * @brief Handler for /ws - WebSocket handshake and incoming commands
+ */
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
+
+    if (req->method == HTTP_GET) {
+        // Handshake done: the broadcaster keeps it alive and pushes to it
+        log_request(req, ROUTE_WS);
+
+        // Token for this session, also set in req so httpd keeps it after
+        // the handler returns (it copies req->sess_ctx back to the session)
+        uint32_t session = ++s_ws_sessions;
+        if (session == 0) session = ++s_ws_sessions;
+        req->sess_ctx = (void *)(uintptr_t)session;
+        req->free_ctx = ws_session_free;
+        httpd_sess_set_ctx(req->handle, fd, req->sess_ctx, ws_session_free);
+
+        stream_client_t c = {
+            .ws = true,
+            .fd = fd,
+            .session = session,
+            .reader_id = -1,
+            .batch = malloc(CONFIG_LOG_SSE_BATCH_BYTES + SSE_LINE_TEXT),
+            .last_send = xTaskGetTickCount(),
+        };
+        if (!c.batch || !stream_post(STREAM_ADD, &c)) {
+            free(c.batch);
+            log_response(500, "websocket", 0);
+            return ESP_FAIL;
+        }
+        log_response(101, "websocket", 0);
+        return ESP_OK;
+    }
+
+    uint8_t buf[WS_RX_MAX];
+    httpd_ws_frame_t frame = { .payload = buf };
+
+    // Length first, so an oversized frame is refused rather than truncated
+    if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK || frame.len > sizeof(buf)) {
+        return ESP_FAIL;
+    }
+    if (frame.len > 0 && httpd_ws_recv_frame(req, &frame, sizeof(buf)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    if (frame.type != HTTPD_WS_TYPE_BINARY || frame.len < 2) {
+        return ESP_OK;          // Nothing we understand; ignore it
+    }
+
+    uint8_t op = buf[0];
+    const uint8_t *args = buf + 2;
+    size_t args_len = frame.len - 2;
+
+    uint8_t reply[3 + WS_PING_MAX];
+    size_t len = 3;
+    reply[0] = WS_REPLY | op;
+    reply[1] = buf[1];
+    reply[2] = WS_OK;
+
+    switch (op) {
+    case WS_OP_PING:
+        if (args_len > WS_PING_MAX) {
+            reply[2] = WS_ERR_REQUEST;
+            break;
+        }
+        memcpy(reply + len, args, args_len);
+        len += args_len;
+        break;
+
+    case WS_OP_LED:
+        if (args_len != 1) {
+            reply[2] = WS_ERR_REQUEST;
+            break;
+        }
+        led_set(args[0] != 0);
+        reply[len++] = s_led_state;
+        break;
+
+    case WS_OP_STATUS:
+        len += put_le((char *)reply + len, event_log_flags(), 4);
+        reply[len++] = s_led_state;
+        len += put_le((char *)reply + len, log_buffer_head_seq(), 8);
+        break;
+
+    case WS_OP_RESET:
+        break;
+
+    case WS_OP_SUBSCRIBE:
+        reply[2] = ws_subscribe(fd, args, args_len);
+        break;
+
+    default:
+        reply[2] = WS_ERR_REQUEST;
+        break;
+    }
+
+    esp_err_t ret = ws_send(fd, ws_session_token(fd), HTTPD_WS_TYPE_BINARY, reply, len);
+
+    if (op == WS_OP_RESET) {
+        ESP_LOGW(TAG, "Reset requested over WebSocket, restarting in 100 ms");
+        vTaskDelay(pdMS_TO_TICKS(100));
+        esp_restart();
+    }
+    return ret;
+}
+
+static const httpd_uri_t ws_uri = {
+    .uri       = "/ws",
+    .method    = HTTP_GET,
+    .handler   = ws_handler,
+    .user_ctx  = NULL,
+    .is_websocket = true,
+};
+#endif // CONFIG_HTTPD_WS_SUPPORT
+
+/**
+ * @brief Handler for GET /logs_all - Static log dump
+ *
+ * Returns all buffered logs as plain text (not SSE).
+ * Useful for viewing logs from before connecting to the stream.
+ *
+ * The ring is streamed in LOGS_ALL_CHUNK pieces through a cursor, so the
+ * dump needs no ring-sized buffer and never holds up loggers. ?tail=N
+ * returns only the last N lines; ?level=, ?tag=, ?grep= filter as for
+ * /logs. A query too long to parse whole is refused with 400.
+ */
+static esp_err_t logs_all_handler(httpd_req_t *req)
+{
+    #define LOGS_ALL_CHUNK 1024
+    log_request(req, ROUTE_LOGS_ALL);
+
+    char query[LOG_QUERY_MAX];
+    if (!log_query(req, query)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "query too long");
+        log_response(400, "text/plain", 0);
+        return ESP_FAIL;
+    }
+
+    char val[12];
+    uint32_t tail = 0;
+    if (httpd_query_key_value(query, "tail", val, sizeof(val)) == ESP_OK) {
+        tail = (uint32_t)strtoul(val, NULL, 10);
+    }
+
+    log_filter_t filter;
+    bool filtered = parse_log_filter(query, &filter);
+
+    char *chunk = malloc(LOGS_ALL_CHUNK);
+    if (!chunk) {
+        ESP_LOGE(TAG, "malloc failed for log chunk");
+        httpd_resp_send_500(req);
+        log_response(500, "text/plain", 0);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "text/plain; charset=utf-8");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    // Lines the ring lost mid-write are reported, never silently skipped
+    uint32_t dropped = log_buffer_get_dropped();
+    char dropped_hdr[12];
+    snprintf(dropped_hdr, sizeof(dropped_hdr), "%lu", (unsigned long)dropped);
+    httpd_resp_set_hdr(req, "X-Log-Dropped", dropped_hdr);
+
+    log_cursor_t cur;
+    log_buffer_cursor_init(&cur, tail);
+
+    size_t total_len = 0;
+    size_t len;
+    esp_err_t ret = ESP_OK;
+    while ((len = log_buffer_read_text(&cur, chunk, LOGS_ALL_CHUNK, filtered ? &filter : NULL)) > 0) {
+        ret = httpd_resp_send_chunk(req, chunk, len);
+        if (ret != ESP_OK) break;
+        total_len += len;
+    }
+
+    if (ret == ESP_OK) {
+        len = 0;
+        if (total_len == 0) {
+            len = snprintf(chunk, LOGS_ALL_CHUNK, "(no logs in buffer)\n");
+        }
+        if (cur.lost > 0) {
+            len += snprintf(chunk + len, LOGS_ALL_CHUNK - len,
+                            "(%lu log lines overwritten during the dump)\n", (unsigned long)cur.lost);
+        }
+        if (dropped > 0) {
+            len += snprintf(chunk + len, LOGS_ALL_CHUNK - len,
+                            "(%lu log lines dropped)\n", (unsigned long)dropped);
+        }
+        if (len > 0) {
+            httpd_resp_send_chunk(req, chunk, len);
+        }
+        httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+#if CONFIG_HTTP_ACCESS_LOG_VERBOSE
+    ESP_LOGI(TAG, "| Sent %lu lines%s", (unsigned long)cur.lines,
+             ret == ESP_OK ? "" : " (client went away)");
+#endif
+    // 499 (nginx's "client closed request") marks a dump cut short
+    log_response(ret == ESP_OK ? 200 : 499, "text/plain", total_len);
+
+    free(chunk);
+    return ret;
+}
+
+static const httpd_uri_t logs_all_uri = {
+    .uri       = "/logs_all",
+    .method    = HTTP_GET,
+    .handler   = logs_all_handler,
+    .user_ctx  = NULL
+};
+
+/**
+ * @brief Handler for GET /logs/stats - Log ring occupancy and history depth (JSON)
+ */
+static esp_err_t logs_stats_handler(httpd_req_t *req)
+{
+    #define LOGS_STATS_BUF_SIZE (768 + CONFIG_LOG_MAX_READERS * 192)
+    log_request(req, ROUTE_LOGS_STATS);
+    char *buf = malloc(LOGS_STATS_BUF_SIZE);
+    log_reader_stats_t *readers = malloc(CONFIG_LOG_MAX_READERS * sizeof(log_reader_stats_t));
+    if (!buf || !readers) {
+        free(buf);
+        free(readers);
+        httpd_resp_send_500(req);
+        log_response(500, "application/json", 0);
+        return ESP_FAIL;
+    }
+
+    log_buffer_stats_t st;
+    log_buffer_get_stats(&st);
+    cdc_log_stats_t cdc;
+    cdc_log_get_stats(&cdc);
+    size_t n = log_buffer_get_reader_stats(readers, CONFIG_LOG_MAX_READERS);
+
+    int len = snprintf(buf, LOGS_STATS_BUF_SIZE,
+        "{\"capacity_bytes\":%lu,\"bytes_used\":%lu,\"lines\":%lu,"
+        "\"total_lines\":%lu,\"evicted_lines\":%lu,\"dropped_lines\":%lu,"
+        "\"avg_line_bytes\":%lu,\"est_capacity_lines\":%lu,"
+        "\"delivery_latency_us\":{\"samples\":%lu,\"last\":%lu,\"avg\":%lu,\"max\":%lu},"
+        "\"cdc\":{\"connected\":%s,\"lines_sent\":%lu,\"bytes_sent\":%lu,\"writes\":%lu,"
+        "\"backlog_bytes\":%lu,\"lag_bytes\":%lu,\"dropped_lines\":%lu,\"stalls\":%lu},"
+        "\"reader_slots\":%lu,\"reader_max\":%lu,\"readers\":[",
+        (unsigned long)st.capacity_bytes, (unsigned long)st.bytes_used,
+        (unsigned long)st.lines, (unsigned long)st.total_lines,
+        (unsigned long)st.evicted_lines, (unsigned long)st.dropped_lines,
+        (unsigned long)st.avg_line_bytes, (unsigned long)st.est_capacity_lines,
+        (unsigned long)st.latency_samples, (unsigned long)st.latency_last_us,
+        (unsigned long)st.latency_avg_us, (unsigned long)st.latency_max_us,
+        cdc.connected ? "true" : "false", (unsigned long)cdc.lines_sent,
+        (unsigned long)cdc.bytes_sent, (unsigned long)cdc.writes,
+        (unsigned long)cdc.backlog_bytes, (unsigned long)cdc.lag_bytes,
+        (unsigned long)cdc.dropped_lines, (unsigned long)cdc.stalls,
+        (unsigned long)st.reader_slots, (unsigned long)st.reader_max);
+
+    for (size_t i = 0; i < n; i++) {
+        const log_reader_stats_t *r = &readers[i];
+        len += snprintf(buf + len, LOGS_STATS_BUF_SIZE - len,
+            "%s{\"id\":%d,\"name\":\"%s\",\"lag_bytes\":%lu,\"missed\":%lu,\"lines\":%lu,"
+            "\"bytes_sent\":%lu,\"latency_avg_us\":%lu,\"latency_max_us\":%lu}",
+            i ? "," : "", r->id, r->name, (unsigned long)r->lag_bytes,
+            (unsigned long)r->missed, (unsigned long)r->lines, (unsigned long)r->bytes_sent,
+            (unsigned long)r->latency_avg_us, (unsigned long)r->latency_max_us);
+    }
+    len += snprintf(buf + len, LOGS_STATS_BUF_SIZE - len, "]}");
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_send(req, buf, len);
+    log_response(200, "application/json", len);
+
+    free(readers);
+    free(buf);
+    return ESP_OK;
+}
+
+static const httpd_uri_t logs_stats_uri = {
+    .uri       = "/logs/stats",
+    .method    = HTTP_GET,
+    .handler   = logs_stats_handler,
+    .user_ctx  = NULL
+};
+
+/**
+ * @brief Handler for GET /events - Critical events (sticky, never truncated)
+ */
+static esp_err_t events_handler(httpd_req_t *req)
+{
+    #define EVENTS_BUF_SIZE 4096
+    log_request(req, ROUTE_EVENTS);
+    char *buf = malloc(EVENTS_BUF_SIZE);
+    if (!buf) {
+        httpd_resp_send_500(req);
+        log_response(500, "text/plain", 0);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "text/plain; charset=utf-8");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    size_t len = event_log_get_all(buf, EVENTS_BUF_SIZE);
+    httpd_resp_send(req, buf, len);
+    log_response(200, "text/plain", len);
+
+    free(buf);
+    return ESP_OK;
+}
+
+static const httpd_uri_t events_uri = {
+    .uri       = "/events",
+    .method    = HTTP_GET,
+    .handler   = events_handler,
+    .user_ctx  = NULL
+};
+
+/**
+ * @brief Handler for GET /status - JSON with event flags
+ */
+static esp_err_t status_handler(httpd_req_t *req)
+{
+    #define STATUS_BUF_SIZE 1024
+    log_request(req, ROUTE_STATUS);
+    char *buf = malloc(STATUS_BUF_SIZE);
+    if (!buf) {
+        httpd_resp_send_500(req);
+        log_response(500, "application/json", 0);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    size_t len = event_log_get_status_json(buf, STATUS_BUF_SIZE);
+    httpd_resp_send(req, buf, len);
+    log_response(200, "application/json", len);
+
+    free(buf);
+    return ESP_OK;
+}
 
 static const httpd_uri_t status_uri = {
     .uri       = "/status",
@@ -464,6 +1611,609 @@ static const httpd_uri_t status_uri = {
     .user_ctx  = NULL
 };
 
+/**
+ * @brief Handler for GET /net/histograms - USB NCM traffic histograms (JSON)
+ */
+static esp_err_t histograms_handler(httpd_req_t *req)
+{
+    #define HISTOGRAMS_BUF_SIZE 3072
+    log_request(req, ROUTE_HISTOGRAMS);
+    char *buf = malloc(HISTOGRAMS_BUF_SIZE);
+    if (!buf) {
+        httpd_resp_send_500(req);
+        log_response(500, "application/json", 0);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    size_t len = network_get_histograms_json(buf, HISTOGRAMS_BUF_SIZE);
+    httpd_resp_send(req, buf, len);
+    log_response(200, "application/json", len);
+
+    free(buf);
+    return ESP_OK;
+}
+
+static const httpd_uri_t histograms_uri = {
+    .uri       = "/net/histograms",
+    .method    = HTTP_GET,
+    .handler   = histograms_handler,
+    .user_ctx  = NULL
+};
+
+/**
+ * @brief Handler for GET /access - Access log records as JSON
+ *
+ * ?since=N returns records from sequence number N on (pass the previous
+ * reply's "next" to poll for new ones). Records are rendered a few at a
+ * time into a small stack buffer and sent as chunks.
+ */
+static esp_err_t access_handler(httpd_req_t *req)
+{
+    #define ACCESS_BATCH     8
+    #define ACCESS_CHUNK     640
+    #define ACCESS_REC_MAX   160    // Longest rendered record
+    log_request(req, ROUTE_ACCESS);
+
+    char query[32];
+    char val[12];
+    uint32_t since = 0;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "since", val, sizeof(val)) == ESP_OK) {
+        since = (uint32_t)strtoul(val, NULL, 10);
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    // Stop at the records that existed when the request came in, or a busy
+    // server could keep this loop going
+    uint32_t total = access_log_total();
+    access_log_rec_t recs[ACCESS_BATCH];
+    char chunk[ACCESS_CHUNK];
+    size_t sent = 0;
+    esp_err_t ret = ESP_OK;
+
+    // Records already overwritten are skipped; "first" says where the reply starts
+    uint32_t seq = since;
+    size_t n = access_log_read(seq, recs, 0, &seq);     // Only clamps seq
+    int len = snprintf(chunk, sizeof(chunk), "{\"total\":%lu,\"first\":%lu,\"records\":[",
+                       (unsigned long)total, (unsigned long)seq);
+
+    bool comma = false;
+    while (ret == ESP_OK && seq < total) {
+        size_t want = (total - seq < ACCESS_BATCH) ? total - seq : ACCESS_BATCH;
+        n = access_log_read(seq, recs, want, &seq);
+        if (n == 0) break;
+
+        for (size_t i = 0; i < n && ret == ESP_OK; i++) {
+            const access_log_rec_t *r = &recs[i];
+            const char *route = r->route < ROUTE_COUNT ? ROUTE_NAMES[r->route] : "?";
+            len += snprintf(chunk + len, sizeof(chunk) - len,
+                "%s{\"seq\":%lu,\"t_ms\":%lu,\"method\":\"%s\",\"route\":\"%s\","
+                "\"status\":%u,\"bytes\":%lu,\"latency_us\":%lu,\"sock\":%d}",
+                comma ? "," : "", (unsigned long)(seq - n + i), (unsigned long)r->ts_ms,
+                http_method_str((httpd_method_t)r->method), route, (unsigned)r->status,
+                (unsigned long)r->bytes, (unsigned long)r->latency_us, r->sock);
+            comma = true;
+
+            if (len > ACCESS_CHUNK - ACCESS_REC_MAX) {
+                ret = httpd_resp_send_chunk(req, chunk, len);
+                sent += len;
+                len = 0;
+            }
+        }
+    }
+
+    if (ret == ESP_OK) {
+        len += snprintf(chunk + len, sizeof(chunk) - len, "],\"next\":%lu}", (unsigned long)seq);
+        ret = httpd_resp_send_chunk(req, chunk, len);
+        sent += len;
+    }
+    if (ret == ESP_OK) {
+        httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    log_response(ret == ESP_OK ? 200 : 499, "application/json", sent);
+    return ret;
+}
+
+static const httpd_uri_t access_uri = {
+    .uri       = "/access",
+    .method    = HTTP_GET,
+    .handler   = access_handler,
+    .user_ctx  = NULL
+};
+
+// ----------------------------
+// Prometheus metrics
+// ----------------------------
+#define METRICS_CHUNK       1024
+#define METRICS_MAX_TASKS   32
+
+/**
+ * @brief Everything /metrics reports, copied before any text is rendered
+ *
+ * Static rather than on the stack (it is a couple of KB, the httpd task
+ * has 4 KB) or the heap; handlers all run on the one httpd task, so one
+ * instance is enough.
+ */
+typedef struct {
+    int64_t uptime_us;
+    network_stats_t net;
+    network_datapath_stats_t dp;
+    log_buffer_stats_t log;
+    cdc_log_stats_t cdc;
+    log_reader_stats_t readers[CONFIG_LOG_MAX_READERS];
+    size_t reader_count;
+    route_stats_t routes[ROUTE_COUNT];
+    uint32_t access_total;
+    uint32_t event_counts[EVT_COUNT];
+    size_t events_listed;
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    uint32_t heap_largest_block;
+    uint32_t heap_internal_free;
+    uint32_t task_count;
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    TaskStatus_t tasks[METRICS_MAX_TASKS];
+    uint32_t tasks_listed;          // 0 if more than METRICS_MAX_TASKS exist
+#endif
+} metrics_snapshot_t;
+
+static metrics_snapshot_t s_metrics;
+
+// Text is built in one chunk buffer and sent whenever the next line won't fit
+typedef struct {
+    httpd_req_t *req;
+    size_t len;
+    size_t sent;
+    esp_err_t err;
+    char buf[METRICS_CHUNK];
+} metrics_writer_t;
+
+static metrics_writer_t s_metrics_out;
+
+static void metrics_snapshot(metrics_snapshot_t *m)
+{
+    m->uptime_us = esp_timer_get_time();
+    network_get_stats(&m->net);
+    network_get_datapath_stats(&m->dp);
+    log_buffer_get_stats(&m->log);
+    cdc_log_get_stats(&m->cdc);
+    m->reader_count = log_buffer_get_reader_stats(m->readers, CONFIG_LOG_MAX_READERS);
+    memcpy(m->routes, s_route_stats, sizeof(m->routes));
+    m->access_total = access_log_total();
+    event_log_type_counts(m->event_counts);
+    m->events_listed = event_log_count();
+
+    m->heap_free = esp_get_free_heap_size();
+    m->heap_min_free = esp_get_minimum_free_heap_size();
+    m->heap_largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    m->heap_internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+
+    m->task_count = uxTaskGetNumberOfTasks();
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    m->tasks_listed = uxTaskGetSystemState(m->tasks, METRICS_MAX_TASKS, NULL);
+#endif
+}
+
+static void metrics_flush(metrics_writer_t *w)
+{
+    if (w->len > 0 && w->err == ESP_OK) {
+        w->err = httpd_resp_send_chunk(w->req, w->buf, w->len);
+        w->sent += w->len;
+    }
+    w->len = 0;
+}
+
+static void metrics_printf(metrics_writer_t *w, const char *fmt, ...)
+{
+    if (w->err != ESP_OK) return;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(w->buf + w->len, METRICS_CHUNK - w->len, fmt, ap);
+        va_end(ap);
+        if (n >= 0 && (size_t)n < METRICS_CHUNK - w->len) {
+            w->len += n;
+            return;
+        }
+        metrics_flush(w);
+    }
+}
+
+static void metrics_header(metrics_writer_t *w, const char *name, const char *type,
+                           const char *help)
+{
+    metrics_printf(w, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void metrics_value(metrics_writer_t *w, const char *name, const char *type,
+                          const char *help, uint64_t value)
+{
+    metrics_header(w, name, type, help);
+    metrics_printf(w, "%s %llu\n", name, (unsigned long long)value);
+}
+
+// Prometheus wants seconds; print microseconds as a fixed-point value
+#define US_TO_SEC_FMT       "%llu.%06llu"
+#define US_TO_SEC(us)       (unsigned long long)((us) / 1000000), \
+                            (unsigned long long)((us) % 1000000)
+
+static void metrics_render_network(metrics_writer_t *w, const metrics_snapshot_t *m)
+{
+    const network_stats_t *n = &m->net;
+    const network_datapath_stats_t *dp = &m->dp;
+
+    metrics_value(w, "ncm_rx_packets_total", "counter", "Frames received from the host", n->rx_packets);
+    metrics_value(w, "ncm_rx_bytes_total", "counter", "Bytes received from the host", n->rx_bytes);
+    metrics_value(w, "ncm_rx_errors_total", "counter", "esp_netif_receive failures", n->rx_errors);
+    metrics_value(w, "ncm_rx_copied_bytes_total", "counter",
+                  "Bytes copied between the NTB and lwIP", n->rx_bytes_copied);
+    metrics_header(w, "ncm_rx_drops_total", "counter", "Received frames discarded before lwIP");
+    metrics_printf(w, "ncm_rx_drops_total{reason=\"not_ready\"} %llu\n"
+                      "ncm_rx_drops_total{reason=\"oversize\"} %llu\n"
+                      "ncm_rx_drops_total{reason=\"no_buffer\"} %llu\n"
+                      "ncm_rx_drops_total{reason=\"ring_full\"} %llu\n",
+                   (unsigned long long)n->rx_drop_not_ready, (unsigned long long)n->rx_drop_oversize,
+                   (unsigned long long)n->rx_drop_no_buffer, (unsigned long long)n->rx_drop_ring_full);
+
+    metrics_value(w, "ncm_tx_packets_total", "counter", "Frames delivered to TinyUSB", n->tx_packets);
+    metrics_value(w, "ncm_tx_bytes_total", "counter", "Bytes delivered to TinyUSB", n->tx_bytes);
+    metrics_value(w, "ncm_tx_retries_total", "counter", "USB send retries", n->tx_retries);
+    metrics_header(w, "ncm_tx_drops_total", "counter", "Frames not delivered to the host");
+    metrics_printf(w, "ncm_tx_drops_total{reason=\"not_ready\"} %llu\n"
+                      "ncm_tx_drops_total{reason=\"oversize\"} %llu\n"
+                      "ncm_tx_drops_total{reason=\"queue_full\"} %llu\n"
+                      "ncm_tx_drops_total{reason=\"link_down\"} %llu\n"
+                      "ncm_tx_drops_total{reason=\"usb_timeout\"} %llu\n"
+                      "ncm_tx_drops_total{reason=\"usb_error\"} %llu\n",
+                   (unsigned long long)n->tx_drop_not_ready, (unsigned long long)n->tx_drop_oversize,
+                   (unsigned long long)n->tx_drop_queue_full, (unsigned long long)n->tx_drop_link_down,
+                   (unsigned long long)n->tx_drop_usb_timeout, (unsigned long long)n->tx_drop_usb_error);
+    metrics_value(w, "ncm_tx_agg_flushes_total", "counter",
+                  "TX batches submitted back-to-back", n->tx_agg_flushes);
+    metrics_value(w, "ncm_tx_agg_datagrams_total", "counter",
+                  "Frames sent in TX batches", n->tx_agg_datagrams);
+    metrics_value(w, "ncm_tx_agg_bypass_total", "counter",
+                  "Small frames sent without waiting for a batch", n->tx_agg_bypass);
+
+    metrics_value(w, "ncm_rx_pool_capacity_frames", "gauge", "RX frame buffers", dp->rx_pool_capacity);
+    metrics_value(w, "ncm_rx_pool_in_use_frames", "gauge", "RX frame buffers held by lwIP",
+                  dp->rx_pool_in_use);
+    metrics_value(w, "ncm_rx_pool_in_use_peak_frames", "gauge", "Peak RX frame buffers in use",
+                  dp->rx_pool_in_use_hwm);
+    metrics_value(w, "ncm_rx_pool_exhausted_total", "counter",
+                  "RX buffer allocations that found the pool empty", dp->rx_pool_exhausted);
+    metrics_value(w, "ncm_rx_ring_depth_frames", "gauge", "Frames waiting for the RX worker",
+                  dp->rx_ring_depth);
+    metrics_value(w, "ncm_rx_ring_peak_frames", "gauge", "Peak RX worker backlog", dp->rx_ring_hwm);
+    metrics_value(w, "ncm_tx_queue_capacity_frames", "gauge", "TX frames that can be queued",
+                  dp->tx_queue_capacity);
+    metrics_value(w, "ncm_tx_queue_depth_frames", "gauge", "TX frames queued or in flight",
+                  dp->tx_queue_depth);
+    metrics_value(w, "ncm_tx_queue_peak_frames", "gauge", "Peak TX queue depth", dp->tx_queue_hwm);
+    metrics_value(w, "ncm_tx_agg_max_batch_frames", "gauge", "Largest TX batch seen",
+                  dp->tx_agg_max_batch);
+}
+
+static void metrics_render_http(metrics_writer_t *w, const metrics_snapshot_t *m)
+{
+    metrics_header(w, "ncm_http_requests_total", "counter", "HTTP requests by route");
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        metrics_printf(w, "ncm_http_requests_total{route=\"%s\"} %lu\n", ROUTE_NAMES[i],
+                       (unsigned long)m->routes[i].requests);
+    }
+    metrics_header(w, "ncm_http_errors_total", "counter", "HTTP responses with status 400 and up");
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        metrics_printf(w, "ncm_http_errors_total{route=\"%s\"} %lu\n", ROUTE_NAMES[i],
+                       (unsigned long)m->routes[i].errors);
+    }
+    metrics_header(w, "ncm_http_response_bytes_total", "counter", "HTTP response body bytes");
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        metrics_printf(w, "ncm_http_response_bytes_total{route=\"%s\"} %llu\n", ROUTE_NAMES[i],
+                       (unsigned long long)m->routes[i].bytes);
+    }
+    metrics_header(w, "ncm_http_request_duration_seconds", "summary",
+                   "Handler entry to response sent");
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        metrics_printf(w, "ncm_http_request_duration_seconds_sum{route=\"%s\"} " US_TO_SEC_FMT "\n"
+                          "ncm_http_request_duration_seconds_count{route=\"%s\"} %lu\n",
+                       ROUTE_NAMES[i], US_TO_SEC(m->routes[i].latency_sum_us),
+                       ROUTE_NAMES[i], (unsigned long)m->routes[i].requests);
+    }
+    metrics_header(w, "ncm_http_request_duration_max_seconds", "gauge", "Slowest request per route");
+    for (int i = 0; i < ROUTE_COUNT; i++) {
+        metrics_printf(w, "ncm_http_request_duration_max_seconds{route=\"%s\"} " US_TO_SEC_FMT "\n",
+                       ROUTE_NAMES[i], US_TO_SEC(m->routes[i].latency_max_us));
+    }
+    metrics_value(w, "ncm_http_access_log_records_total", "counter",
+                  "Records written to the access log", m->access_total);
+}
+
+static void metrics_render_logs(metrics_writer_t *w, const metrics_snapshot_t *m)
+{
+    const log_buffer_stats_t *l = &m->log;
+
+    metrics_value(w, "ncm_log_ring_capacity_bytes", "gauge", "Log ring size", l->capacity_bytes);
+    metrics_value(w, "ncm_log_ring_used_bytes", "gauge", "Log ring bytes in use", l->bytes_used);
+    metrics_value(w, "ncm_log_ring_lines", "gauge", "Lines held in the log ring", l->lines);
+    metrics_value(w, "ncm_log_lines_total", "counter", "Log lines written", l->total_lines);
+    metrics_value(w, "ncm_log_lines_evicted_total", "counter",
+                  "Log lines overwritten by newer ones", l->evicted_lines);
+    metrics_value(w, "ncm_log_lines_dropped_total", "counter",
+                  "Log lines lost mid-write", l->dropped_lines);
+    metrics_header(w, "ncm_log_delivery_latency_seconds", "gauge",
+                   "Log write to reader delivery latency");
+    metrics_printf(w, "ncm_log_delivery_latency_seconds{stat=\"avg\"} " US_TO_SEC_FMT "\n"
+                      "ncm_log_delivery_latency_seconds{stat=\"max\"} " US_TO_SEC_FMT "\n",
+                   US_TO_SEC(l->latency_avg_us), US_TO_SEC(l->latency_max_us));
+
+    metrics_value(w, "ncm_log_readers", "gauge", "Log readers in use", m->reader_count);
+    metrics_header(w, "ncm_log_reader_lag_bytes", "gauge", "Ring bytes a reader has not read yet");
+    for (size_t i = 0; i < m->reader_count; i++) {
+        metrics_printf(w, "ncm_log_reader_lag_bytes{id=\"%d\",name=\"%s\"} %lu\n",
+                       m->readers[i].id, m->readers[i].name, (unsigned long)m->readers[i].lag_bytes);
+    }
+    metrics_header(w, "ncm_log_reader_missed_lines_total", "counter",
+                   "Lines a reader lost to the ring lapping it");
+    for (size_t i = 0; i < m->reader_count; i++) {
+        metrics_printf(w, "ncm_log_reader_missed_lines_total{id=\"%d\",name=\"%s\"} %lu\n",
+                       m->readers[i].id, m->readers[i].name, (unsigned long)m->readers[i].missed);
+    }
+
+    metrics_value(w, "ncm_cdc_connected", "gauge", "Serial terminal attached", m->cdc.connected);
+    metrics_value(w, "ncm_cdc_bytes_total", "counter", "Log bytes sent over CDC", m->cdc.bytes_sent);
+    metrics_value(w, "ncm_cdc_dropped_lines_total", "counter",
+                  "Log lines overwritten before the serial host read them", m->cdc.dropped_lines);
+    metrics_value(w, "ncm_cdc_stalls_total", "counter",
+                  "CDC writes that timed out", m->cdc.stalls);
+
+    metrics_value(w, "ncm_events_listed", "gauge", "Events held in the event list", m->events_listed);
+    metrics_header(w, "ncm_events_total", "counter", "Critical events by type");
+    for (int i = 0; i < EVT_COUNT; i++) {
+        metrics_printf(w, "ncm_events_total{type=\"%s\"} %lu\n",
+                       event_log_type_name((event_type_t)i), (unsigned long)m->event_counts[i]);
+    }
+}
+
+static void metrics_render_system(metrics_writer_t *w, const metrics_snapshot_t *m)
+{
+    metrics_header(w, "ncm_uptime_seconds", "gauge", "Time since boot");
+    metrics_printf(w, "ncm_uptime_seconds " US_TO_SEC_FMT "\n", US_TO_SEC((uint64_t)m->uptime_us));
+    metrics_value(w, "ncm_heap_free_bytes", "gauge", "Free heap", m->heap_free);
+    metrics_value(w, "ncm_heap_min_free_bytes", "gauge", "Lowest free heap since boot",
+                  m->heap_min_free);
+    metrics_value(w, "ncm_heap_largest_free_block_bytes", "gauge", "Largest allocatable block",
+                  m->heap_largest_block);
+    metrics_value(w, "ncm_heap_internal_free_bytes", "gauge", "Free internal RAM",
+                  m->heap_internal_free);
+    metrics_value(w, "ncm_tasks", "gauge", "FreeRTOS tasks", m->task_count);
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    metrics_header(w, "ncm_task_stack_free_bytes", "gauge", "Lowest free stack seen per task");
+    for (uint32_t i = 0; i < m->tasks_listed; i++) {
+        metrics_printf(w, "ncm_task_stack_free_bytes{task=\"%s\"} %lu\n",
+                       m->tasks[i].pcTaskName, (unsigned long)m->tasks[i].usStackHighWaterMark);
+    }
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    metrics_header(w, "ncm_task_runtime_total", "counter", "Run time counter ticks per task");
+    for (uint32_t i = 0; i < m->tasks_listed; i++) {
+        metrics_printf(w, "ncm_task_runtime_total{task=\"%s\"} %lu\n",
+                       m->tasks[i].pcTaskName, (unsigned long)m->tasks[i].ulRunTimeCounter);
+    }
+#endif
+#endif
+}
+
+/**
+ * @brief Handler for GET /metrics - Runtime counters in Prometheus text format
+ *
+ * All sources are copied into s_metrics first, so one scrape is a single
+ * point-in-time view, then rendered through a static chunk buffer. Nothing
+ * is allocated.
+ */
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+    log_request(req, ROUTE_METRICS);
+
+    metrics_snapshot(&s_metrics);
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    metrics_writer_t *w = &s_metrics_out;
+    w->req = req;
+    w->len = 0;
+    w->sent = 0;
+    w->err = ESP_OK;
+
+    metrics_render_network(w, &s_metrics);
+    metrics_render_http(w, &s_metrics);
+    metrics_render_logs(w, &s_metrics);
+    metrics_render_system(w, &s_metrics);
+    metrics_flush(w);
+
+    if (w->err == ESP_OK) {
+        httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    log_response(w->err == ESP_OK ? 200 : 499, "text/plain", w->sent);
+    return w->err;
+}
+
+static const httpd_uri_t metrics_uri = {
+    .uri       = "/metrics",
+    .method    = HTTP_GET,
+    .handler   = metrics_handler,
+    .user_ctx  = NULL
+};
+
+#if CONFIG_NCM_PCAP_CAPTURE
+/**
+ * @brief Handler for GET /capture.pcap - Download the capture ring as pcap
+ *
+ * Streams everything captured up to the moment of the request, record by
+ * record, without pausing capture. Frames evicted while the download runs
+ * are skipped.
+ */
+static esp_err_t capture_pcap_handler(httpd_req_t *req)
+{
+    log_request(req, ROUTE_CAPTURE_PCAP);
+
+    #define CAPTURE_CHUNK_SIZE 2048
+    uint8_t *buf = malloc(CAPTURE_CHUNK_SIZE);
+    if (!buf) {
+        httpd_resp_send_500(req);
+        log_response(500, "application/vnd.tcpdump.pcap", 0);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/vnd.tcpdump.pcap");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"ncm.pcap\"");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    size_t len = pcap_capture_global_header(buf);
+    size_t total_len = len;
+    esp_err_t ret = httpd_resp_send_chunk(req, (const char *)buf, len);
+
+    pcap_cursor_t cur;
+    pcap_capture_cursor_init(&cur);
+    while (ret == ESP_OK) {
+        len = pcap_capture_read(&cur, buf, CAPTURE_CHUNK_SIZE);
+        if (len == 0) break;
+        ret = httpd_resp_send_chunk(req, (const char *)buf, len);
+        if (ret == ESP_OK) total_len += len;
+    }
+
+    if (ret == ESP_OK) {
+        httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    free(buf);
+    log_response(ret == ESP_OK ? 200 : 499, "application/vnd.tcpdump.pcap", total_len);
+    return ret;
+}
+
+static const httpd_uri_t capture_pcap_uri = {
+    .uri       = "/capture.pcap",
+    .method    = HTTP_GET,
+    .handler   = capture_pcap_handler,
+    .user_ctx  = NULL
+};
+
+static const char *pcap_mode_name(pcap_mode_t mode)
+{
+    switch (mode) {
+    case PCAP_MODE_HEADERS: return "headers";
+    case PCAP_MODE_FULL:    return "full";
+    default:                return "off";
+    }
+}
+
+// Send the capture status JSON; GET and POST /capture both answer with it
+static void capture_status_send(httpd_req_t *req)
+{
+    pcap_capture_status_t st;
+    pcap_capture_get_status(&st);
+
+    char buf[320];
+    int len = snprintf(buf, sizeof(buf),
+        "{\"mode\":\"%s\",\"ethertype\":%u,\"port\":%u,"
+        "\"ring_size\":%lu,\"bytes_used\":%lu,\"records\":%lu,"
+        "\"captured\":%lu,\"evicted\":%lu,\"dropped\":%lu}",
+        pcap_mode_name(st.config.mode),
+        (unsigned)st.config.ethertype, (unsigned)st.config.port,
+        (unsigned long)st.ring_size, (unsigned long)st.bytes_used,
+        (unsigned long)st.records, (unsigned long)st.captured,
+        (unsigned long)st.evicted, (unsigned long)st.dropped);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_send(req, buf, len);
+    log_response(200, "application/json", len);
+}
+
+/**
+ * @brief Handler for GET /capture - Capture configuration and counters (JSON)
+ */
+static esp_err_t capture_status_handler(httpd_req_t *req)
+{
+    log_request(req, ROUTE_CAPTURE);
+    capture_status_send(req);
+    return ESP_OK;
+}
+
+static const httpd_uri_t capture_status_uri = {
+    .uri       = "/capture",
+    .method    = HTTP_GET,
+    .handler   = capture_status_handler,
+    .user_ctx  = NULL
+};
+
+/**
+ * @brief Handler for POST /capture - Configure capture
+ *
+ * Query: mode=off|headers|full, ethertype=0x0800 (optional),
+ * port=67 (optional, TCP/UDP source or destination). Missing filters match
+ * anything. Responds with the new status.
+ */
+static esp_err_t capture_config_handler(httpd_req_t *req)
+{
+    char query[96];
+    char val[16];
+    pcap_capture_config_t cfg = { .mode = PCAP_MODE_FULL };
+
+    log_request(req, ROUTE_CAPTURE);
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "mode", val, sizeof(val)) == ESP_OK) {
+            if (strcmp(val, "off") == 0) {
+                cfg.mode = PCAP_MODE_OFF;
+            } else if (strcmp(val, "headers") == 0) {
+                cfg.mode = PCAP_MODE_HEADERS;
+            } else if (strcmp(val, "full") == 0) {
+                cfg.mode = PCAP_MODE_FULL;
+            } else {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "mode must be off, headers or full");
+                log_response(400, "application/json", 0);
+                return ESP_FAIL;
+            }
+        }
+        if (httpd_query_key_value(query, "ethertype", val, sizeof(val)) == ESP_OK) {
+            cfg.ethertype = (uint16_t)strtoul(val, NULL, 0);
+        }
+        if (httpd_query_key_value(query, "port", val, sizeof(val)) == ESP_OK) {
+            cfg.port = (uint16_t)strtoul(val, NULL, 0);
+        }
+    }
+
+    esp_err_t ret = pcap_capture_configure(&cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Capture configure failed: %s", esp_err_to_name(ret));
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "capture ring allocation failed");
+        log_response(500, "application/json", 0);
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Capture: mode=%s ethertype=0x%04x port=%u",
+             pcap_mode_name(cfg.mode), cfg.ethertype, cfg.port);
+    capture_status_send(req);
+    return ESP_OK;
+}
+
+static const httpd_uri_t capture_config_uri = {
+    .uri       = "/capture",
+    .method    = HTTP_POST,
+    .handler   = capture_config_handler,
+    .user_ctx  = NULL
+};
+#endif
+
 /**
  * @brief Start the HTTP server
  *
@@ -486,11 +2236,34 @@ esp_err_t http_server_start(void)
     gpio_set_level(LED_GPIO, LED_OFF);  // Start with LED off
     ESP_LOGI(TAG, "  LED GPIO %d initialized (active-low)", LED_GPIO);
 
+    // Log streams are served by their own task, not from inside a handler
+    if (!s_stream_task) {
+        if (!s_stream_queue) {
+            s_stream_queue = xQueueCreate(2 * HTTP_MAX_SOCKETS, sizeof(stream_msg_t));
+        }
+        if (!s_stream_queue ||
+            xTaskCreate(stream_task, "log_streams", STREAM_TASK_STACK, NULL, STREAM_TASK_PRIORITY,
+                        &s_stream_task) != pdPASS) {
+            ESP_LOGE(TAG, "  FAILED to start log stream broadcaster");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+#if CONFIG_HTTPD_WS_SUPPORT
+    if (!s_ws_lock) {
+        s_ws_lock = xSemaphoreCreateMutex();
+        if (!s_ws_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+#endif
+
     // Configure HTTP server
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.lru_purge_enable = true;  // Close stale connections
     config.server_port = 80;
-    config.max_uri_handlers = 12;    // We have 9 handlers, leave room for more
+    config.max_uri_handlers = 20;    // We have 16 handlers plus one per page, leave room for more
+    config.max_open_sockets = HTTP_MAX_SOCKETS;
+    config.close_fn = stream_sock_closed;   // Drop WebSocket clients with their socket
 
     ESP_LOGI(TAG, "  Port: %d", config.server_port);
     ESP_LOGI(TAG, "  Max URI handlers: %d", config.max_uri_handlers);
@@ -507,8 +2280,18 @@ esp_err_t http_server_start(void)
     // Register URI handlers
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "Registering URI handlers:");
-    ESP_LOGI(TAG, "  GET  /          -> root_handler (status page)");
-    httpd_register_uri_handler(s_server, &root_uri);
+    for (size_t i = 0; i < static_assets_count; i++) {
+        const static_asset_t *asset = &static_assets[i];
+        httpd_uri_t uri = {
+            .uri      = asset->uri,
+            .method   = HTTP_GET,
+            .handler  = asset_handler,
+            .user_ctx = (void *)asset,
+        };
+        ESP_LOGI(TAG, "  GET  %-10s -> asset_handler (%u bytes, %u gzipped)", asset->uri,
+                 (unsigned)asset->raw_len, (unsigned)asset->gz_len);
+        httpd_register_uri_handler(s_server, &uri);
+    }
 
     ESP_LOGI(TAG, "  GET  /led       -> led_status_handler (get state)");
     httpd_register_uri_handler(s_server, &led_status_uri);
@@ -525,15 +2308,43 @@ esp_err_t http_server_start(void)
     ESP_LOGI(TAG, "  GET  /logs      -> logs_sse_handler (SSE log stream)");
     httpd_register_uri_handler(s_server, &logs_sse_uri);
 
+#if CONFIG_HTTPD_WS_SUPPORT
+    ESP_LOGI(TAG, "  GET  /ws        -> ws_handler (WebSocket: logs, events, commands)");
+    httpd_register_uri_handler(s_server, &ws_uri);
+#endif
+
     ESP_LOGI(TAG, "  GET  /logs_all  -> logs_all_handler (all buffered logs)");
     httpd_register_uri_handler(s_server, &logs_all_uri);
 
+    ESP_LOGI(TAG, "  GET  /logs/stats -> logs_stats_handler (log ring + CDC drain JSON)");
+    httpd_register_uri_handler(s_server, &logs_stats_uri);
+
     ESP_LOGI(TAG, "  GET  /events    -> events_handler (critical events)");
     httpd_register_uri_handler(s_server, &events_uri);
 
     ESP_LOGI(TAG, "  GET  /status    -> status_handler (event flags JSON)");
     httpd_register_uri_handler(s_server, &status_uri);
 
+    ESP_LOGI(TAG, "  GET  /net/histograms -> histograms_handler (NCM traffic histograms)");
+    httpd_register_uri_handler(s_server, &histograms_uri);
+
+    ESP_LOGI(TAG, "  GET  /access    -> access_handler (HTTP access log JSON)");
+    httpd_register_uri_handler(s_server, &access_uri);
+
+    ESP_LOGI(TAG, "  GET  /metrics   -> metrics_handler (Prometheus text format)");
+    httpd_register_uri_handler(s_server, &metrics_uri);
+
+#if CONFIG_NCM_PCAP_CAPTURE
+    ESP_LOGI(TAG, "  GET  /capture.pcap -> capture_pcap_handler (packet capture download)");
+    httpd_register_uri_handler(s_server, &capture_pcap_uri);
+
+    ESP_LOGI(TAG, "  GET  /capture   -> capture_status_handler (capture status JSON)");
+    httpd_register_uri_handler(s_server, &capture_status_uri);
+
+    ESP_LOGI(TAG, "  POST /capture   -> capture_config_handler (mode/filter)");
+    httpd_register_uri_handler(s_server, &capture_config_uri);
+#endif
+
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "HTTP server started at http://192.168.7.1/");
     ESP_LOGI(TAG, "");
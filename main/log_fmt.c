@@ -0,0 +1,425 @@
+/*
+ * Deferred Log Formatting Implementation
+ * Capture printf-style arguments at log time, render the text on demand
+ *
+ * Design:
+ * - One conversion-spec parser shared by the packer and the renderer, so
+ *   both walk the format string identically and agree on argument types
+ * - Arguments are stored with their exact C type (int, long, size_t, ...)
+ *   and handed back to snprintf one conversion at a time
+ * - Packing never formats anything; its cost is one pass over the format
+ *   string plus a memcpy per argument
+ * - The renderer doesn't trust the blob: pointers must point into flash and
+ *   copied strings must fit, otherwise a placeholder is rendered instead
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "log_fmt.h"
+#include "esp_memory_utils.h"
+
+#define STR_PTR             0       // %s argument stored as a flash pointer
+#define STR_INLINE          1       // %s argument copied: u8 length + bytes
+#define SPEC_MAX            24      // Longest rebuilt conversion spec
+#define PIECE_MAX           128     // Longest single rendered conversion
+#define BAD_LINE            "<unreadable packed log line>"
+#define BAD_ARG             "<?>"
+
+typedef enum {
+    LEN_NONE = 0,
+    LEN_HH,
+    LEN_H,
+    LEN_L,
+    LEN_LL,
+    LEN_Z,
+    LEN_J,
+    LEN_T,
+    LEN_BIG_L,              // long double: not supported
+} len_mod_t;
+
+typedef struct {
+    const char *start;      // The '%'
+    const char *end;        // One past the conversion character
+    char conv;
+    uint8_t len;            // len_mod_t
+    bool star_width;
+    bool star_prec;
+    int prec;               // Literal precision, -1 if none (or '*')
+} fmt_spec_t;
+
+static inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Parse the conversion starting at p ('%'). False on a truncated spec.
+static bool parse_spec(const char *p, fmt_spec_t *spec)
+{
+    memset(spec, 0, sizeof(*spec));
+    spec->start = p++;
+    spec->prec = -1;
+
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') p++;
+
+    if (*p == '*') {
+        spec->star_width = true;
+        p++;
+    } else {
+        while (is_digit(*p)) p++;
+    }
+
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->star_prec = true;
+            p++;
+        } else {
+            spec->prec = 0;
+            for (; is_digit(*p); p++) {
+                if (spec->prec < 10000) spec->prec = spec->prec * 10 + (*p - '0');
+            }
+        }
+    }
+
+    switch (*p) {
+    case 'h':
+        p++;
+        spec->len = (*p == 'h') ? (p++, LEN_HH) : LEN_H;
+        break;
+    case 'l':
+        p++;
+        spec->len = (*p == 'l') ? (p++, LEN_LL) : LEN_L;
+        break;
+    case 'z': p++; spec->len = LEN_Z; break;
+    case 'j': p++; spec->len = LEN_J; break;
+    case 't': p++; spec->len = LEN_T; break;
+    case 'L': p++; spec->len = LEN_BIG_L; break;
+    default: break;
+    }
+
+    if (*p == '\0') return false;
+    spec->conv = *p;
+    spec->end = p + 1;
+    return true;
+}
+
+// ----------------------------
+// Packing
+// ----------------------------
+#define PUT(type, val) do {                         \
+        type v_ = (val);                            \
+        if (n + sizeof(v_) > size) return 0;        \
+        memcpy(blob + n, &v_, sizeof(v_));          \
+        n += sizeof(v_);                            \
+    } while (0)
+
+size_t log_fmt_pack(uint8_t *blob, size_t size, const char *fmt, va_list args)
+{
+    if (!blob || !fmt || !esp_ptr_in_drom(fmt)) return 0;
+
+    size_t n = 0;
+    PUT(const char *, fmt);
+
+    for (const char *p = strchr(fmt, '%'); p; p = strchr(p, '%')) {
+        fmt_spec_t spec;
+        if (!parse_spec(p, &spec)) return 0;
+        p = spec.end;
+
+        if (spec.conv == '%') continue;
+        if (spec.star_width) PUT(int, va_arg(args, int));
+        int prec = spec.prec;
+        if (spec.star_prec) {
+            prec = va_arg(args, int);   // Negative: as if omitted
+            PUT(int, prec);
+        }
+
+        switch (spec.conv) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            if (spec.conv == 'c' && spec.len != LEN_NONE) return 0;
+            switch (spec.len) {
+            case LEN_L:     PUT(long, va_arg(args, long)); break;
+            case LEN_LL:    PUT(long long, va_arg(args, long long)); break;
+            case LEN_Z:     PUT(size_t, va_arg(args, size_t)); break;
+            case LEN_J:     PUT(intmax_t, va_arg(args, intmax_t)); break;
+            case LEN_T:     PUT(ptrdiff_t, va_arg(args, ptrdiff_t)); break;
+            case LEN_BIG_L: return 0;
+            default:        PUT(int, va_arg(args, int)); break;    // hh/h promote to int
+            }
+            break;
+
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            if (spec.len == LEN_BIG_L) return 0;
+            PUT(double, va_arg(args, double));
+            break;
+
+        case 'p':
+            PUT(void *, va_arg(args, void *));
+            break;
+
+        case 's': {
+            if (spec.len != LEN_NONE) return 0;
+            const char *s = va_arg(args, const char *);
+            if (!s) s = "(null)";
+            if (esp_ptr_in_drom(s)) {
+                PUT(uint8_t, STR_PTR);
+                PUT(const char *, s);
+            } else {
+                // Longer strings are formatted as text, never cut short.
+                // With a precision the string needn't be terminated: read
+                // no further than it, as printf wouldn't either.
+                size_t max = LOG_FMT_STR_MAX + 1;
+                if (prec >= 0 && (size_t)prec < max) max = (size_t)prec;
+                size_t l = strnlen(s, max);
+                if (l > LOG_FMT_STR_MAX) return 0;
+                PUT(uint8_t, STR_INLINE);
+                PUT(uint8_t, (uint8_t)l);
+                if (n + l > size) return 0;
+                memcpy(blob + n, s, l);
+                n += l;
+            }
+            break;
+        }
+
+        default:
+            return 0;       // %n and anything unknown: format as text
+        }
+    }
+
+    return n;
+}
+
+// ----------------------------
+// Rendering
+// ----------------------------
+#define GET(type, dst) do {                         \
+        if (n + sizeof(type) > blob_len) goto done; \
+        memcpy(&(dst), blob + n, sizeof(type));     \
+        n += sizeof(type);                          \
+    } while (0)
+
+static inline void emit(char *out, size_t size, size_t *total, const char *s, size_t len)
+{
+    if (*total < size) {
+        size_t room = size - *total;
+        memcpy(out + *total, s, (len < room) ? len : room);
+    }
+    *total += len;
+}
+
+// Copy spec with '*' replaced by the recorded width/precision
+static bool build_spec(char *dst, const fmt_spec_t *spec, int width, int prec)
+{
+    size_t o = 0;
+    bool first_star = true;
+
+    for (const char *p = spec->start; p < spec->end; p++) {
+        if (o + 12 >= SPEC_MAX) return false;
+
+        if (*p != '*') {
+            dst[o++] = *p;
+            continue;
+        }
+        if (first_star && spec->star_width) {
+            o += (size_t)snprintf(dst + o, SPEC_MAX - o, "%d", width);
+        } else if (prec >= 0) {
+            o += (size_t)snprintf(dst + o, SPEC_MAX - o, "%d", prec);
+        } else if (o > 0 && dst[o - 1] == '.') {
+            o--;                // Negative precision: as if omitted
+        }
+        first_star = false;
+    }
+    dst[o] = '\0';
+    return true;
+}
+
+size_t log_fmt_render(char *out, size_t size, const uint8_t *blob, size_t blob_len)
+{
+    size_t n = 0;
+    size_t total = 0;
+    const char *fmt = NULL;
+
+    GET(const char *, fmt);
+    if (!esp_ptr_in_drom(fmt)) {
+        emit(out, size, &total, BAD_LINE, sizeof(BAD_LINE) - 1);
+        goto done;
+    }
+
+    const char *p = fmt;
+    while (*p) {
+        const char *pct = strchr(p, '%');
+        if (!pct) {
+            emit(out, size, &total, p, strlen(p));
+            break;
+        }
+        emit(out, size, &total, p, (size_t)(pct - p));
+
+        fmt_spec_t spec;
+        if (!parse_spec(pct, &spec)) break;
+        p = spec.end;
+
+        if (spec.conv == '%') {
+            emit(out, size, &total, "%", 1);
+            continue;
+        }
+
+        int width = 0;
+        int prec = -1;
+        if (spec.star_width) GET(int, width);
+        if (spec.star_prec) GET(int, prec);
+
+        char sub[SPEC_MAX];
+        if (!build_spec(sub, &spec, width, prec)) {
+            emit(out, size, &total, spec.start, (size_t)(spec.end - spec.start));
+            continue;
+        }
+
+        char piece[PIECE_MAX];
+        int len = 0;
+
+        switch (spec.conv) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            switch (spec.len) {
+            case LEN_L:  { long v;      GET(long, v);      len = snprintf(piece, sizeof(piece), sub, v); break; }
+            case LEN_LL: { long long v; GET(long long, v); len = snprintf(piece, sizeof(piece), sub, v); break; }
+            case LEN_Z:  { size_t v;    GET(size_t, v);    len = snprintf(piece, sizeof(piece), sub, v); break; }
+            case LEN_J:  { intmax_t v;  GET(intmax_t, v);  len = snprintf(piece, sizeof(piece), sub, v); break; }
+            case LEN_T:  { ptrdiff_t v; GET(ptrdiff_t, v); len = snprintf(piece, sizeof(piece), sub, v); break; }
+            default:     { int v;       GET(int, v);       len = snprintf(piece, sizeof(piece), sub, v); break; }
+            }
+            break;
+
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A': {
+            double v;
+            GET(double, v);
+            len = snprintf(piece, sizeof(piece), sub, v);
+            break;
+        }
+
+        case 'p': {
+            void *v;
+            GET(void *, v);
+            len = snprintf(piece, sizeof(piece), sub, v);
+            break;
+        }
+
+        case 's': {
+            uint8_t kind;
+            GET(uint8_t, kind);
+
+            const char *s;
+            char sbuf[LOG_FMT_STR_MAX + 1];
+            if (kind == STR_PTR) {
+                GET(const char *, s);
+                if (!esp_ptr_in_drom(s)) s = BAD_ARG;
+            } else {
+                uint8_t l;
+                GET(uint8_t, l);
+                if (kind != STR_INLINE || l > LOG_FMT_STR_MAX || n + l > blob_len) {
+                    // The rest of the blob can't be trusted either
+                    emit(out, size, &total, BAD_ARG, sizeof(BAD_ARG) - 1);
+                    goto done;
+                }
+                memcpy(sbuf, blob + n, l);
+                sbuf[l] = '\0';
+                n += l;
+                s = sbuf;
+            }
+
+            // Plain %s (the tag, mostly) skips snprintf entirely
+            if (strcmp(sub, "%s") == 0) {
+                emit(out, size, &total, s, strlen(s));
+                continue;
+            }
+            len = snprintf(piece, sizeof(piece), sub, s);
+            break;
+        }
+
+        default:
+            goto done;
+        }
+
+        if (len > 0) {
+            emit(out, size, &total, piece, ((size_t)len < sizeof(piece)) ? (size_t)len : sizeof(piece) - 1);
+        }
+    }
+
+done:
+    return total;
+}
+
+// ----------------------------
+// Argument lookup
+// ----------------------------
+bool log_fmt_str_arg(const uint8_t *blob, size_t blob_len, unsigned index,
+                     const char **str, size_t *len)
+{
+    size_t n = 0;
+    const char *fmt = NULL;
+    unsigned seen = 0;
+
+    GET(const char *, fmt);
+    if (!esp_ptr_in_drom(fmt)) goto done;
+
+    for (const char *p = strchr(fmt, '%'); p; p = strchr(p, '%')) {
+        fmt_spec_t spec;
+        if (!parse_spec(p, &spec)) break;
+        p = spec.end;
+
+        if (spec.conv == '%') continue;
+        if (spec.star_width) n += sizeof(int);
+        if (spec.star_prec) n += sizeof(int);
+
+        switch (spec.conv) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            switch (spec.len) {
+            case LEN_L:  n += sizeof(long); break;
+            case LEN_LL: n += sizeof(long long); break;
+            case LEN_Z:  n += sizeof(size_t); break;
+            case LEN_J:  n += sizeof(intmax_t); break;
+            case LEN_T:  n += sizeof(ptrdiff_t); break;
+            default:     n += sizeof(int); break;
+            }
+            break;
+
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            n += sizeof(double);
+            break;
+
+        case 'p':
+            n += sizeof(void *);
+            break;
+
+        case 's': {
+            uint8_t kind;
+            const char *s;
+            size_t l;
+            GET(uint8_t, kind);
+            if (kind == STR_PTR) {
+                GET(const char *, s);
+                if (!esp_ptr_in_drom(s)) goto done;
+                l = strlen(s);
+            } else {
+                uint8_t l8;
+                GET(uint8_t, l8);
+                if (kind != STR_INLINE || l8 > LOG_FMT_STR_MAX || n + l8 > blob_len) goto done;
+                s = (const char *)blob + n;
+                l = l8;
+                n += l8;
+            }
+            if (seen++ == index) {
+                *str = s;
+                *len = l;
+                return true;
+            }
+            break;
+        }
+
+        default:
+            goto done;
+        }
+    }
+
+done:
+    return false;
+}
@@ -0,0 +1,73 @@
+/*
+ * Deferred Log Formatting Header
+ * Capture printf-style arguments at log time, render the text on demand
+ *
+ * A packed line is the format string pointer followed by the raw argument
+ * values. Strings that live in flash are kept as pointers; any other string
+ * is copied, since the caller's buffer is gone by the time a reader formats
+ * the line.
+ */
+
+#pragma once
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_FMT_STR_MAX     96      // Longest copied %s argument (longer: line is text)
+
+/**
+ * @brief Pack a format string and its arguments
+ *
+ * Fails (returns 0) when the line can't be deferred: the format string is
+ * not in flash, it uses a conversion this packer doesn't handle (%n, wide
+ * strings, long double), a %s argument outside flash is longer than
+ * LOG_FMT_STR_MAX, or the arguments don't fit in size bytes. The
+ * caller then formats the line as text instead. A %s with a precision
+ * ("%.*s") is read no further than the precision, so it may point at a
+ * buffer without a terminator.
+ *
+ * @param blob  Output buffer
+ * @param size  Buffer size
+ * @param fmt   printf format string
+ * @param args  Arguments (consumed; pass a va_copy if you need them again)
+ * @return Packed length, or 0
+ */
+size_t log_fmt_pack(uint8_t *blob, size_t size, const char *fmt, va_list args);
+
+/**
+ * @brief Render a packed line as text
+ *
+ * Writes at most size bytes and no terminator. A blob whose format or
+ * string pointers don't point into flash, or whose copied strings are too
+ * long, renders a placeholder instead of being dereferenced.
+ *
+ * @param out       Output buffer
+ * @param size      Output buffer size
+ * @param blob      Packed line from log_fmt_pack()
+ * @param blob_len  Packed length
+ * @return Full text length (may exceed size, like snprintf)
+ */
+size_t log_fmt_render(char *out, size_t size, const uint8_t *blob, size_t blob_len);
+
+/**
+ * @brief Find a %s argument of a packed line without rendering it
+ *
+ * @param blob      Packed line from log_fmt_pack()
+ * @param blob_len  Packed length
+ * @param index     Which %s conversion (0 = first)
+ * @param str       Output: the string (not NUL-terminated if it was copied)
+ * @param len       Output: its length
+ * @return false if the format has fewer %s conversions
+ */
+bool log_fmt_str_arg(const uint8_t *blob, size_t blob_len, unsigned index,
+                     const char **str, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,97 +3,712 @@
  * Circular buffer for log storage and SSE streaming
  *
  * Design:
- * - Fixed-size circular buffer of log lines
- * - Multiple readers (SSE clients) each track their own position
- * - Thread-safe using FreeRTOS mutex
- * - Oldest logs are overwritten when buffer is full
+ * - One packed byte ring of variable-length records (header + text), so
+ *   short lines don't pay for the longest possible line
+ * - Writers never lock: a line reserves its bytes (and its sequence number)
+ *   with one compare-and-swap on the ring state, copies its text, then
+ *   commits by stamping the record header with its own position
+ * - Readers never block writers: they copy a record out, then re-check the
+ *   reservation position and the record's stamp; if a writer has lapped them
+ *   meanwhile the copy is discarded and they resume at the oldest surviving
+ *   record
+ * - A writer preempted for a whole lap between reserving and committing
+ *   finds its bytes reserved again and drops its line instead of writing.
+ *   Claiming and committing a header are both compare-and-swaps on its
+ *   stamp, so a stale writer can't take back or un-commit a header that a
+ *   newer lap owns
+ * - A record never straddles the end of the ring: if it doesn't fit, the
+ *   rest of the lap is padded and the record starts at offset 0
+ * - Oldest logs are overwritten when buffer is full; gaps in the sequence
+ *   numbers tell a reader exactly how many lines it missed
+ * - The reader-slot table is the only thing still behind a mutex, and only
+ *   reader setup/teardown takes it. Slots are heap-allocated on first use
+ *   (up to CONFIG_LOG_MAX_READERS) and recycled, never freed, because
+ *   writers walk the table without a lock
+ * - Idle readers block on a per-reader binary semaphore; a writer only
+ *   gives it when that reader has announced it is about to sleep. A task
+ *   serving several readers (the SSE broadcaster) sleeps on one shared
+ *   semaphore the same way
+ * - A line is stored either as text or packed (format pointer + raw
+ *   arguments, see log_fmt.h); packed lines are rendered by whichever
+ *   reader consumes them, after the copy has been validated
+ * - Each header also records the line's level and a 12-bit hash of its tag,
+ *   parsed once at write time, so a filtered reader rejects most lines
+ *   without copying or rendering them
+ * - Headers carry the low 32 bits of the sequence number; readers widen it
+ *   to 64 bits against a base that writers refresh every 2^30 lines, so a
+ *   sequence number names one line for the life of the device
  */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "log_stream.h"
+#include "log_fmt.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "esp_timer.h"
 
 // Configuration
-#define LOG_BUFFER_LINES    200     // Number of log lines to buffer (increased for boot replay)
+#define LOG_BUFFER_BYTES    (48 * 1024) // Ring size (same RAM as the old 200 x 256 line matrix)
 #define LOG_LINE_MAX_LEN    256     // Max length per line
-#define MAX_READERS         4       // Max concurrent SSE clients
 
-// Circular buffer of log lines
-static char s_log_buffer[LOG_BUFFER_LINES][LOG_LINE_MAX_LEN];
-static size_t s_log_lengths[LOG_BUFFER_LINES];  // Actual length of each line
-static int s_write_idx = 0;                      // Next write position
-static int s_total_written = 0;                  // Total lines ever written (for reader sync)
+#define LOG_HINT_CHUNK      1024    // Granularity of the resync table
+#define LOG_HINT_COUNT      (LOG_BUFFER_BYTES / LOG_HINT_CHUNK)
+#define LOG_REC_WRAP        0xFFFF  // Header len of a lap padding record
+#define LOG_REC_COMMITTED   1u      // Stamp bit: positions are 4-aligned
 
-// Reader tracking - each SSE client has a read position
-static int s_reader_pos[MAX_READERS];    // Last read position for each reader
-static bool s_reader_active[MAX_READERS]; // Is this reader slot in use?
+// Positions are byte counters that wrap at a multiple of the ring size, so
+// pos % LOG_BUFFER_BYTES stays continuous when the counter rolls over.
+#define LOG_POS_WRAP        ((UINT32_MAX / LOG_BUFFER_BYTES) * LOG_BUFFER_BYTES)
 
-// Thread safety
+// Writers republish the 64-bit sequence base whenever these bits are zero
+#define LOG_SEQ_BASE_MASK   0x3FFFFFFFu
+
+/**
+ * Record header. stamp == (position | LOG_REC_COMMITTED) once the text is
+ * complete; anything else means "being written" or "left over from an
+ * older lap".
+ */
+typedef struct {
+    uint32_t stamp;
+    uint32_t seq;
+    uint32_t ts_us;         // esp_timer time of the write (low 32 bits)
+    uint16_t len;           // Payload length, or LOG_REC_WRAP
+    uint16_t flags;         // LOG_REC_F_*
+} log_rec_hdr_t;
+
+#define LOG_REC_F_PACKED    0x0001  // Payload is log_fmt_pack() output, not text
+#define LOG_REC_LEVEL_SHIFT 1       // esp_log_level_t, 0 = not an ESP_LOG line
+#define LOG_REC_LEVEL_MASK  0x7
+#define LOG_REC_TAG_SHIFT   4       // Tag hash, 0 = no tag
+#define LOG_REC_TAG_MASK    0xFFF
+
+#define LOG_REC_HDR_LEN     sizeof(log_rec_hdr_t)
+#define LOG_REC_MAX_SIZE    (LOG_REC_HDR_LEN + LOG_LINE_MAX_LEN)
+
+typedef enum {
+    LINE_NONE = 0,          // Caught up
+    LINE_OK,
+    LINE_SKIPPED,           // Consumed, but the filter rejected it
+} line_status_t;
+
+// A log_filter_t with its tag hashes precomputed
+typedef struct {
+    bool active;
+    log_filter_t f;
+    uint16_t tag_hash[LOG_FILTER_MAX_TAGS];
+} log_match_t;
+
+typedef enum {
+    REC_OK,
+    REC_WRAP,               // Padding to the end of the lap
+    REC_NOT_READY,          // Caught up, or the writer is still copying
+    REC_LAPPED,             // Overwritten before (or while) we read it
+} rec_status_t;
+
+// Ring: low 32 bits = reservation position, high 32 bits = next sequence
+static uint8_t s_log_ring[LOG_BUFFER_BYTES] __attribute__((aligned(4)));
+static uint64_t s_state = 0;
+static bool s_filled = false;               // Ring has wrapped at least once
+static uint32_t s_hints[LOG_HINT_COUNT];    // First record at/after each chunk
+static uint32_t s_dropped = 0;              // Lines overwritten mid-copy
+static uint64_t s_seq_base = 0;             // Within 2^30 lines of the head
+
+/**
+ * Reader state. Each slot is owned by one task (an SSE handler, the CDC
+ * drain), so only alloc/free need the mutex.
+ */
+typedef struct {
+    bool active;
+    char name[LOG_READER_NAME_LEN];
+    bool synced;            // next_seq is valid
+    bool waiting;           // Blocked in log_buffer_wait(); writers give wake
+    SemaphoreHandle_t wake;
+    uint32_t pos;           // Next record position
+    uint64_t next_seq;
+    uint32_t missed;        // Lines lost to laps (seq gaps)
+    bool ts_pending;        // line_ts_us set since the last mark_delivered
+    uint32_t line_ts_us;    // Write time of the oldest undelivered line
+    log_match_t match;      // Lines this reader wants
+    uint32_t pending_gap;   // Lost before filtered-out lines; reported on the next match
+    uint32_t lines;         // Lines returned
+    uint32_t bytes_sent;    // As reported to log_buffer_mark_delivered()
+    uint32_t lat_samples;
+    uint64_t lat_sum_us;
+    uint32_t lat_max_us;
+    char line[LOG_LINE_MAX_LEN]; // Line returned by log_buffer_read()
+} log_reader_t;
+
+// Slots [0, s_reader_slots) are allocated; a pointer never changes once set
+static log_reader_t *s_readers[CONFIG_LOG_MAX_READERS];
+static int s_reader_slots = 0;
+
+// Write-to-delivery latency, fed by log_buffer_mark_delivered()
+static uint32_t s_lat_samples = 0;
+static uint64_t s_lat_sum_us = 0;
+static uint32_t s_lat_max_us = 0;
+static uint32_t s_lat_last_us = 0;
+
+// Thread safety (reader slots only)
 static SemaphoreHandle_t s_mutex = NULL;
 
-void log_buffer_init(void)
+// log_buffer_wait_any(): one waiter at a time, woken like a reader
+static bool s_any_waiting = false;
+static SemaphoreHandle_t s_any_wake = NULL;
+
+// ----------------------------
+// Position arithmetic
+// ----------------------------
+static inline uint32_t pos_add(uint32_t a, uint32_t n)
+{
+    return (n >= LOG_POS_WRAP - a) ? n - (LOG_POS_WRAP - a) : a + n;
+}
+
+static inline uint32_t pos_sub(uint32_t a, uint32_t n)
+{
+    return (a >= n) ? a - n : a + (LOG_POS_WRAP - n);
+}
+
+// Distance from b forward to a
+static inline uint32_t pos_diff(uint32_t a, uint32_t b)
+{
+    return (a >= b) ? a - b : a + (LOG_POS_WRAP - b);
+}
+
+static inline uint32_t ring_off(uint32_t pos)
+{
+    return pos % LOG_BUFFER_BYTES;
+}
+
+static inline uint32_t lap_room(uint32_t pos)
+{
+    return LOG_BUFFER_BYTES - ring_off(pos);
+}
+
+static inline uint32_t rec_size(size_t len)
+{
+    return (uint32_t)((LOG_REC_HDR_LEN + len + 3) & ~(size_t)3);
+}
+
+static inline uint32_t head_pos(void)
+{
+    return (uint32_t)__atomic_load_n(&s_state, __ATOMIC_ACQUIRE);
+}
+
+// True once a writer has reserved the bytes at pos for a newer lap
+static inline bool pos_lapped(uint32_t pos)
+{
+    return pos_diff(head_pos(), pos) > LOG_BUFFER_BYTES;
+}
+
+// Widen a header sequence number. Every line still in the ring (and the
+// head) is within 2^31 of the base, so the signed difference is exact.
+static inline uint64_t seq_extend(uint32_t seq)
+{
+    uint64_t base = __atomic_load_n(&s_seq_base, __ATOMIC_ACQUIRE);
+    return base + (int64_t)(int32_t)(seq - (uint32_t)base);
+}
+
+static inline uint64_t head_seq(void)
 {
-    s_mutex = xSemaphoreCreateMutex();
+    return seq_extend((uint32_t)(__atomic_load_n(&s_state, __ATOMIC_ACQUIRE) >> 32));
+}
 
-    // Initialize buffer
-    memset(s_log_buffer, 0, sizeof(s_log_buffer));
-    memset(s_log_lengths, 0, sizeof(s_log_lengths));
-    s_write_idx = 0;
-    s_total_written = 0;
+// ----------------------------
+// Line metadata
+// ----------------------------
+static const char LEVEL_CHARS[] = "EWIDV";  // esp_log_level_t 1..5
 
-    // Initialize readers
-    for (int i = 0; i < MAX_READERS; i++) {
-        s_reader_pos[i] = 0;
-        s_reader_active[i] = false;
+// ESP_LOG lines look like "<color>L (<time>) <tag>: ...". Returns the level
+// and the offset just past "L (", or 0 if the line has another shape.
+static uint8_t parse_level(const char *s, size_t len, size_t *after)
+{
+    size_t i = 0;
+    if (len >= 2 && s[0] == '\033' && s[1] == '[') {
+        while (i < len && s[i] != 'm') i++;
+        i++;
     }
+    if (i + 2 >= len || s[i + 1] != ' ' || s[i + 2] != '(') return 0;
+
+    const char *l = memchr(LEVEL_CHARS, s[i], sizeof(LEVEL_CHARS) - 1);
+    if (!l) return 0;
+    *after = i + 3;
+    return (uint8_t)(l - LEVEL_CHARS + 1);
 }
 
-void log_buffer_add(const char *line, size_t len)
+// Tag of a rendered line: from ") " to the next ": "
+static bool text_tag(const char *s, size_t len, const char **tag, size_t *tag_len)
+{
+    size_t i;
+    if (!parse_level(s, len, &i)) return false;
+
+    const char *end = s + len;
+    const char *t = memchr(s + i, ')', len - i);
+    if (!t || end - t < 2 || t[1] != ' ') return false;
+    t += 2;
+
+    for (const char *c = t; c + 1 < end; c++) {
+        if (c[0] == ':' && c[1] == ' ') {
+            *tag = t;
+            *tag_len = (size_t)(c - t);
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint16_t tag_hash(const char *tag, size_t len)
+{
+    uint32_t h = 2166136261u;   // FNV-1a, folded to 12 bits
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)tag[i]) * 16777619u;
+    }
+    h = (h ^ (h >> 12) ^ (h >> 24)) & LOG_REC_TAG_MASK;
+    return h ? (uint16_t)h : 1;
+}
+
+static uint16_t meta_flags(uint8_t level, const char *tag, size_t tag_len)
+{
+    uint16_t flags = (uint16_t)(level << LOG_REC_LEVEL_SHIFT);
+    if (tag) {
+        flags |= (uint16_t)(tag_hash(tag, tag_len) << LOG_REC_TAG_SHIFT);
+    }
+    return flags;
+}
+
+static uint16_t text_meta(const char *line, size_t len)
+{
+    size_t after;
+    uint8_t level = parse_level(line, len, &after);
+    if (!level) return 0;
+
+    const char *tag = NULL;
+    size_t tag_len = 0;
+    text_tag(line, len, &tag, &tag_len);
+    return meta_flags(level, tag, tag_len);
+}
+
+// Same, from the format string and packed arguments: the tag is the %s
+// right after ") ", whichever %s that is (the time may be one too)
+static uint16_t packed_meta(const char *fmt, const uint8_t *packed, size_t len)
 {
-    if (!s_mutex || !line || len == 0) return;
+    size_t after;
+    uint8_t level = parse_level(fmt, strnlen(fmt, 16), &after);
+    if (!level) return 0;
 
-    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
-        return;  // Skip if can't get mutex quickly (don't block logging)
+    const char *tag = NULL;
+    size_t tag_len = 0;
+    const char *at = strstr(fmt + after, ") %s: ");
+    if (at) {
+        unsigned index = 0;
+        for (const char *p = fmt + after; (p = strstr(p, "%s")) && p < at; p += 2) {
+            index++;
+        }
+        if (!log_fmt_str_arg(packed, len, index, &tag, &tag_len)) {
+            tag = NULL;
+        }
     }
+    return meta_flags(level, tag, tag_len);
+}
+
+static void match_compile(log_match_t *m, const log_filter_t *f)
+{
+    memset(m, 0, sizeof(*m));
+    if (!f || (f->max_level == 0 && f->tag_count == 0 && f->grep[0] == '\0')) return;
+
+    m->f = *f;
+    if (m->f.tag_count > LOG_FILTER_MAX_TAGS) {
+        m->f.tag_count = LOG_FILTER_MAX_TAGS;
+    }
+    for (int i = 0; i < m->f.tag_count; i++) {
+        m->f.tags[i][LOG_FILTER_TAG_LEN - 1] = '\0';
+        m->tag_hash[i] = tag_hash(m->f.tags[i], strlen(m->f.tags[i]));
+    }
+    m->f.grep[LOG_FILTER_GREP_LEN - 1] = '\0';
+    m->active = true;
+}
+
+// Header-only check: level and tag hash
+static bool match_meta(const log_match_t *m, uint16_t flags)
+{
+    if (m->f.max_level) {
+        uint8_t level = (flags >> LOG_REC_LEVEL_SHIFT) & LOG_REC_LEVEL_MASK;
+        if (level == 0 || level > m->f.max_level) return false;
+    }
+    if (m->f.tag_count) {
+        uint16_t hash = (flags >> LOG_REC_TAG_SHIFT) & LOG_REC_TAG_MASK;
+        for (int i = 0; i < m->f.tag_count; i++) {
+            if (m->tag_hash[i] == hash) return true;
+        }
+        return false;
+    }
+    return true;
+}
+
+// Text check: exact tag (the hash can collide) and substring
+static bool match_text(const log_match_t *m, const char *text, size_t len)
+{
+    if (m->f.tag_count) {
+        const char *tag;
+        size_t tag_len;
+        if (!text_tag(text, len, &tag, &tag_len)) return false;
+
+        bool found = false;
+        for (int i = 0; i < m->f.tag_count && !found; i++) {
+            found = (strlen(m->f.tags[i]) == tag_len && memcmp(m->f.tags[i], tag, tag_len) == 0);
+        }
+        if (!found) return false;
+    }
+
+    size_t glen = strlen(m->f.grep);
+    if (glen) {
+        for (size_t i = 0; i + glen <= len; i++) {
+            if (text[i] == m->f.grep[0] && memcmp(text + i, m->f.grep, glen) == 0) return true;
+        }
+        return false;
+    }
+    return true;
+}
+
+// ----------------------------
+// Writer side
+// ----------------------------
+
+// Every chunk boundary c in (r, q] learns the first record start at/after it
+static void publish_hints(uint32_t r, uint32_t p, uint32_t q)
+{
+    uint32_t span = pos_diff(q, r);
+    uint32_t rec_at = pos_diff(p, r);
+
+    for (uint32_t d = LOG_HINT_CHUNK - (r % LOG_HINT_CHUNK); d <= span; d += LOG_HINT_CHUNK) {
+        uint32_t c = pos_add(r, d);
+        __atomic_store_n(&s_hints[ring_off(c) / LOG_HINT_CHUNK], (d <= rec_at) ? p : q,
+                         __ATOMIC_RELEASE);
+    }
+}
+
+// Mark the header at pos as being written (stamp == pos, uncommitted). Fails
+// if the slot holds a header from a newer lap: whatever was there before is
+// either a header from an older lap or text, never a stamp ahead of pos.
+static bool claim_header(uint32_t pos)
+{
+    log_rec_hdr_t *hdr = (log_rec_hdr_t *)(s_log_ring + ring_off(pos));
+    uint32_t old = __atomic_load_n(&hdr->stamp, __ATOMIC_RELAXED);
+    do {
+        uint32_t at = old & ~LOG_REC_COMMITTED;
+        if (pos_lapped(pos) ||
+            (at != pos && ring_off(at) == ring_off(pos) && pos_diff(at, pos) < LOG_POS_WRAP / 2)) {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&hdr->stamp, &old, pos, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return true;
+}
+
+// Fill in a claimed header and commit it. The stamp only becomes committed
+// if it still holds this writer's claim; otherwise a newer lap took the
+// slot and the record is dropped.
+static bool commit_header(uint32_t pos, uint32_t seq, uint32_t ts_us, uint16_t len,
+                          uint16_t flags)
+{
+    if (pos_lapped(pos)) return false;
+
+    log_rec_hdr_t *hdr = (log_rec_hdr_t *)(s_log_ring + ring_off(pos));
+    hdr->seq = seq;
+    hdr->ts_us = ts_us;
+    hdr->len = len;
+    hdr->flags = flags;
+
+    uint32_t claimed = pos;
+    return __atomic_compare_exchange_n(&hdr->stamp, &claimed, pos | LOG_REC_COMMITTED, false,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+// Reader for an ID, or NULL if that slot was never allocated
+static inline log_reader_t *get_reader(int reader_id)
+{
+    if (reader_id < 0 || reader_id >= CONFIG_LOG_MAX_READERS) return NULL;
+    return __atomic_load_n(&s_readers[reader_id], __ATOMIC_ACQUIRE);
+}
+
+static inline void give_wake(SemaphoreHandle_t wake)
+{
+    if (xPortInIsrContext()) {
+        xSemaphoreGiveFromISR(wake, NULL);
+    } else {
+        xSemaphoreGive(wake);
+    }
+}
+
+// Wake readers that are blocked in log_buffer_wait() or
+// log_buffer_wait_any(). Costs one load per allocated slot when nobody is
+// waiting.
+static void wake_readers(void)
+{
+    if (__atomic_load_n(&s_any_waiting, __ATOMIC_ACQUIRE) &&
+        __atomic_exchange_n(&s_any_waiting, false, __ATOMIC_ACQ_REL)) {
+        give_wake(s_any_wake);
+    }
+
+    int slots = __atomic_load_n(&s_reader_slots, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < slots; i++) {
+        log_reader_t *rd = __atomic_load_n(&s_readers[i], __ATOMIC_ACQUIRE);
+        if (!rd || !__atomic_load_n(&rd->waiting, __ATOMIC_ACQUIRE)) continue;
+        if (!__atomic_exchange_n(&rd->waiting, false, __ATOMIC_ACQ_REL)) continue;
+        give_wake(rd->wake);
+    }
+}
+
+// ----------------------------
+// Reader side
+// ----------------------------
+static rec_status_t read_record(uint32_t pos, log_rec_hdr_t *out, char *text, size_t cap,
+                                uint8_t *packed)
+{
+    uint32_t head = head_pos();
+    if (pos == head) return REC_NOT_READY;
+    if (pos_diff(head, pos) > LOG_BUFFER_BYTES) return REC_LAPPED;
+    if (lap_room(pos) < LOG_REC_HDR_LEN) return REC_WRAP;   // Too short for a header
+
+    const log_rec_hdr_t *hdr = (const log_rec_hdr_t *)(s_log_ring + ring_off(pos));
+    uint32_t stamp = __atomic_load_n(&hdr->stamp, __ATOMIC_ACQUIRE);
+    if (stamp != (pos | LOG_REC_COMMITTED)) {
+        return pos_lapped(pos) ? REC_LAPPED : REC_NOT_READY;
+    }
+
+    memcpy(out, hdr, sizeof(*out));
+    if (out->len == LOG_REC_WRAP) {
+        // Nothing to copy
+    } else if (out->flags & LOG_REC_F_PACKED) {
+        if (packed) {
+            memcpy(packed, (const uint8_t *)hdr + LOG_REC_HDR_LEN, out->len);
+        }
+    } else if (text) {
+        size_t n = (out->len < cap) ? out->len : cap;
+        memcpy(text, (const uint8_t *)hdr + LOG_REC_HDR_LEN, n);
+    }
+
+    // Valid only if no writer reserved over it while we were copying, and
+    // no stale writer from an older lap stamped over it either
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (pos_lapped(pos)) return REC_LAPPED;
+    if (__atomic_load_n(&hdr->stamp, __ATOMIC_ACQUIRE) != stamp) return REC_NOT_READY;
+
+    return (out->len == LOG_REC_WRAP) ? REC_WRAP : REC_OK;
+}
+
+// Oldest record a lapped (or new) reader can safely start from
+static uint32_t find_oldest(void)
+{
+    uint32_t head = head_pos();
+    if (!__atomic_load_n(&s_filled, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    // Leave one chunk of slack for writers that reserve while we look
+    uint32_t from = pos_sub(head, LOG_BUFFER_BYTES - LOG_HINT_CHUNK);
+    uint32_t c = pos_add(from, (LOG_HINT_CHUNK - from % LOG_HINT_CHUNK) % LOG_HINT_CHUNK);
+
+    for (; pos_diff(head, c) < LOG_BUFFER_BYTES; c = pos_add(c, LOG_HINT_CHUNK)) {
+        uint32_t h = __atomic_load_n(&s_hints[ring_off(c) / LOG_HINT_CHUNK], __ATOMIC_ACQUIRE);
+        // Stale hints from an older lap point before c
+        if (pos_diff(h, c) < LOG_HINT_CHUNK + LOG_REC_MAX_SIZE &&
+            pos_diff(head, h) < LOG_BUFFER_BYTES) {
+            return h;
+        }
+    }
+    return head;
+}
+
+/**
+ * Step a cursor to the next line, skipping padding and resyncing if lapped.
+ * The line's text goes to text (up to cap bytes, no terminator) and its full
+ * length to *text_len; with text == NULL nothing is copied or rendered.
+ * With a filter, a rejected line is stepped over and reported as
+ * LINE_SKIPPED (hdr is still valid). Returns LINE_NONE when caught up.
+ */
+static line_status_t next_line(uint32_t *pos, log_rec_hdr_t *hdr, char *text, size_t cap,
+                               size_t *text_len, const log_match_t *m)
+{
+    uint8_t packed[LOG_LINE_MAX_LEN];
+
+    // Bounded: at most a pad and a couple of resyncs per call
+    for (int i = 0; i < 4; i++) {
+        switch (read_record(*pos, hdr, text, cap, text ? packed : NULL)) {
+        case REC_OK:
+            *pos = pos_add(*pos, rec_size(hdr->len));
+            *text_len = hdr->len;
+            if (m && !match_meta(m, hdr->flags)) {
+                return LINE_SKIPPED;    // Rejected before rendering
+            }
+            if ((hdr->flags & LOG_REC_F_PACKED) && text) {
+                // Render from the validated copy; same truncation as text lines
+                *text_len = log_fmt_render(text, cap, packed, hdr->len);
+                if (*text_len > LOG_LINE_MAX_LEN - 1) {
+                    *text_len = LOG_LINE_MAX_LEN - 1;
+                }
+            }
+            if (m && text && !match_text(m, text, (*text_len < cap) ? *text_len : cap)) {
+                return LINE_SKIPPED;
+            }
+            return LINE_OK;
+        case REC_WRAP:
+            *pos = pos_add(*pos, lap_room(*pos));
+            break;
+        case REC_LAPPED:
+            *pos = find_oldest();
+            break;
+        case REC_NOT_READY:
+            return LINE_NONE;
+        }
+    }
+    return LINE_NONE;
+}
+
+// ----------------------------
+// Public API
+// ----------------------------
+void log_buffer_init(void)
+{
+    // The ring itself needs no setup (lines logged before this are kept),
+    // and reader slots are allocated on demand
+    if (!s_mutex) {
+        s_mutex = xSemaphoreCreateMutex();
+    }
+    if (!s_any_wake) {
+        s_any_wake = xSemaphoreCreateBinary();
+    }
+}
+
+// Reserve, copy and commit one record
+static void append_record(const void *payload, size_t len, uint16_t flags)
+{
+    uint32_t need = rec_size(len);
+
+    // Reserve [r, q): optional lap padding, then our record at p
+    uint64_t st = __atomic_load_n(&s_state, __ATOMIC_RELAXED);
+    uint32_t r, p, q, seq;
+    do {
+        r = (uint32_t)st;
+        seq = (uint32_t)(st >> 32);
+        p = (need > lap_room(r)) ? pos_add(r, lap_room(r)) : r;
+        q = pos_add(p, need);
+    } while (!__atomic_compare_exchange_n(&s_state, &st, ((uint64_t)(seq + 1) << 32) | q,
+                                          true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    if ((seq & LOG_SEQ_BASE_MASK) == 0) {
+        __atomic_store_n(&s_seq_base, seq_extend(seq), __ATOMIC_RELEASE);
+    }
+
+    if (p != r) {
+        if (lap_room(r) >= LOG_REC_HDR_LEN && claim_header(r)) {
+            commit_header(r, 0, 0, LOG_REC_WRAP, 0);
+        }
+        __atomic_store_n(&s_filled, true, __ATOMIC_RELEASE);
+    } else if (ring_off(q) == 0) {
+        __atomic_store_n(&s_filled, true, __ATOMIC_RELEASE);
+    }
+    publish_hints(r, p, q);
+
+    // Claim, copy, then commit. If the whole ring turned over since the
+    // reservation (the writer was preempted that long), these bytes belong
+    // to newer records: abandon the line rather than write over them.
+    uint32_t ts_us = (uint32_t)esp_timer_get_time();
+    uint8_t *text = s_log_ring + ring_off(p) + LOG_REC_HDR_LEN;
+    if (!claim_header(p) || pos_lapped(p)) goto lapped;
+    memcpy(text, payload, len);
+    if (!commit_header(p, seq, ts_us, (uint16_t)len, flags)) goto lapped;
+
+    wake_readers();
+    return;
+
+lapped:
+    __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+}
+
+void log_buffer_add(const char *line, size_t len)
+{
+    if (!line || len == 0) return;
 
     // Truncate if too long
     if (len > LOG_LINE_MAX_LEN - 1) {
         len = LOG_LINE_MAX_LEN - 1;
     }
 
-    // Copy to buffer
-    memcpy(s_log_buffer[s_write_idx], line, len);
-    s_log_buffer[s_write_idx][len] = '\0';
-    s_log_lengths[s_write_idx] = len;
+    append_record(line, len, text_meta(line, len));
+}
 
-    // Advance write pointer
-    s_write_idx = (s_write_idx + 1) % LOG_BUFFER_LINES;
-    s_total_written++;
+bool log_buffer_add_packed(const char *fmt, va_list args)
+{
+    uint8_t packed[LOG_LINE_MAX_LEN];
+    size_t len = log_fmt_pack(packed, sizeof(packed), fmt, args);
+    if (len == 0) {
+        return false;
+    }
 
-    xSemaphoreGive(s_mutex);
+    append_record(packed, len, LOG_REC_F_PACKED | packed_meta(fmt, packed, len));
+    return true;
 }
 
-int log_buffer_alloc_reader(void)
+// New slot at the end of the table; called with the mutex held
+static log_reader_t *grow_readers(void)
+{
+    if (s_reader_slots >= CONFIG_LOG_MAX_READERS) return NULL;
+
+    log_reader_t *rd = calloc(1, sizeof(*rd));
+    if (!rd) return NULL;
+
+    rd->wake = xSemaphoreCreateBinary();
+    if (!rd->wake) {
+        free(rd);
+        return NULL;
+    }
+
+    // Publish the slot before the count, so writers never see a hole
+    __atomic_store_n(&s_readers[s_reader_slots], rd, __ATOMIC_RELEASE);
+    __atomic_store_n(&s_reader_slots, s_reader_slots + 1, __ATOMIC_RELEASE);
+    return rd;
+}
+
+int log_buffer_alloc_reader(const char *name)
 {
     if (!s_mutex) return -1;
 
     int reader_id = -1;
 
     if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        for (int i = 0; i < MAX_READERS; i++) {
-            if (!s_reader_active[i]) {
-                s_reader_active[i] = true;
-                // Start reader at OLDEST available log to replay from boot
-                if (s_total_written <= LOG_BUFFER_LINES) {
-                    s_reader_pos[i] = 0;  // Buffer hasn't wrapped yet
-                } else {
-                    s_reader_pos[i] = s_total_written - LOG_BUFFER_LINES;  // Start at oldest
-                }
+        log_reader_t *rd = NULL;
+        for (int i = 0; i < s_reader_slots; i++) {
+            if (!s_readers[i]->active) {
+                rd = s_readers[i];
                 reader_id = i;
                 break;
             }
         }
+        if (!rd && (rd = grow_readers()) != NULL) {
+            reader_id = s_reader_slots - 1;
+        }
+
+        if (rd) {
+            // Start reader at OLDEST available log to replay from boot
+            rd->pos = find_oldest();
+            rd->synced = false;
+            rd->missed = 0;
+            rd->waiting = false;
+            rd->ts_pending = false;
+            match_compile(&rd->match, NULL);
+            rd->pending_gap = 0;
+            rd->lines = 0;
+            rd->bytes_sent = 0;
+            rd->lat_samples = 0;
+            rd->lat_sum_us = 0;
+            rd->lat_max_us = 0;
+            snprintf(rd->name, sizeof(rd->name), "%s", name ? name : "");
+            xSemaphoreTake(rd->wake, 0);   // Discard a stale wakeup
+            rd->active = true;
+        }
         xSemaphoreGive(s_mutex);
     }
 
@@ -102,125 +717,500 @@ int log_buffer_alloc_reader(void)
 
 void log_buffer_free_reader(int reader_id)
 {
-    if (!s_mutex || reader_id < 0 || reader_id >= MAX_READERS) return;
+    log_reader_t *rd = get_reader(reader_id);
+    if (!s_mutex || !rd) return;
 
     if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        s_reader_active[reader_id] = false;
+        rd->active = false;
         xSemaphoreGive(s_mutex);
     }
 }
 
-bool log_buffer_has_data(int reader_id)
+// Sequence gaps are lines overwritten before this reader got to them.
+// Returns the line's 64-bit sequence number; *gap (optional) gets the gap.
+static uint64_t account_line(log_reader_t *rd, const log_rec_hdr_t *hdr, uint32_t *gap)
 {
-    if (!s_mutex || reader_id < 0 || reader_id >= MAX_READERS) return false;
+    uint64_t seq = seq_extend(hdr->seq);
+    uint32_t lost = 0;
 
-    bool has_data = false;
+    if (rd->synced && seq > rd->next_seq) {
+        lost = (uint32_t)(seq - rd->next_seq);
+        rd->missed += lost;
+    }
+    rd->next_seq = seq + 1;
+    rd->synced = true;
 
-    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        if (s_reader_active[reader_id]) {
-            has_data = (s_reader_pos[reader_id] < s_total_written);
-        }
-        xSemaphoreGive(s_mutex);
+    if (gap) *gap = lost;
+    return seq;
+}
+
+// Count a line handed out; the oldest since the last delivery sets the latency
+static inline void note_line_ts(log_reader_t *rd, const log_rec_hdr_t *hdr)
+{
+    rd->lines++;
+    if (!rd->ts_pending) {
+        rd->line_ts_us = hdr->ts_us;
+        rd->ts_pending = true;
     }
+}
+
+bool log_buffer_has_data(int reader_id)
+{
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd || !rd->active) return false;
 
-    return has_data;
+    // A reserved but not yet committed line doesn't count
+    log_rec_hdr_t hdr;
+    return read_record(rd->pos, &hdr, NULL, 0, NULL) != REC_NOT_READY;
 }
 
 const char *log_buffer_read(int reader_id, size_t *out_len)
 {
-    if (!s_mutex || reader_id < 0 || reader_id >= MAX_READERS) return NULL;
     if (!out_len) return NULL;
 
-    const char *result = NULL;
     *out_len = 0;
 
-    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        if (s_reader_active[reader_id] && s_reader_pos[reader_id] < s_total_written) {
-            // Calculate buffer index from reader position
-            // Handle wrap-around: if reader is too far behind, skip to oldest available
-            int lines_behind = s_total_written - s_reader_pos[reader_id];
-            if (lines_behind > LOG_BUFFER_LINES) {
-                // Reader fell behind, skip to oldest available
-                s_reader_pos[reader_id] = s_total_written - LOG_BUFFER_LINES;
-                lines_behind = LOG_BUFFER_LINES;
-            }
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd || !rd->active) return NULL;
 
-            // Calculate actual buffer index
-            int buf_idx = (s_write_idx - lines_behind + LOG_BUFFER_LINES) % LOG_BUFFER_LINES;
+    log_rec_hdr_t hdr;
+    size_t len;
+    line_status_t st;
+    while ((st = next_line(&rd->pos, &hdr, rd->line, sizeof(rd->line) - 1, &len,
+                           rd->match.active ? &rd->match : NULL)) == LINE_SKIPPED) {
+        account_line(rd, &hdr, NULL);
+    }
+    if (st == LINE_NONE) {
+        return NULL;
+    }
 
-            result = s_log_buffer[buf_idx];
-            *out_len = s_log_lengths[buf_idx];
+    account_line(rd, &hdr, NULL);
+    note_line_ts(rd, &hdr);
+
+    rd->line[len] = '\0';
+    *out_len = len;
+    return rd->line;
+}
 
-            // Advance reader
-            s_reader_pos[reader_id]++;
+size_t log_buffer_read_batch(int reader_id, char *buf, size_t size,
+                             const char *prefix, const char *suffix, uint32_t *out_lines)
+{
+    if (out_lines) *out_lines = 0;
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd || !rd->active || !buf) return 0;
+
+    size_t plen = prefix ? strlen(prefix) : 0;
+    size_t slen = suffix ? strlen(suffix) : 0;
+    size_t used = 0;
+    uint32_t lines = 0;
+
+    while (used + plen + slen < size) {
+        size_t cap = size - used - plen - slen;
+        uint32_t pos = rd->pos;
+        log_rec_hdr_t hdr;
+        size_t len;
+
+        // Text lands in place, after the prefix
+        line_status_t st = next_line(&pos, &hdr, buf + used + plen, cap, &len,
+                                     rd->match.active ? &rd->match : NULL);
+        if (st == LINE_NONE) {
+            rd->pos = pos;      // Keep any pad skip / resync
+            break;
         }
-        xSemaphoreGive(s_mutex);
+        if (st == LINE_SKIPPED) {
+            account_line(rd, &hdr, NULL);
+            rd->pos = pos;
+            continue;
+        }
+
+        if (len > cap) {
+            if (lines > 0) break;   // Leave it for the next batch
+            len = cap;              // Buffer smaller than one line: truncate
+        }
+
+        // Stop at a gap so the caller can report it between batches
+        if (lines > 0 && hdr.seq != (uint32_t)rd->next_seq) break;
+
+        account_line(rd, &hdr, NULL);
+        note_line_ts(rd, &hdr);
+
+        if (plen) memcpy(buf + used, prefix, plen);
+        used += plen + len;
+        if (slen) memcpy(buf + used, suffix, slen);
+        used += slen;
+
+        rd->pos = pos;
+        lines++;
     }
 
-    return result;
+    if (out_lines) *out_lines = lines;
+    return used;
 }
 
-int log_buffer_get_count(void)
+size_t log_buffer_read_lines(int reader_id, log_line_t *lines, size_t max_lines,
+                             char *text, size_t text_size)
+{
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd || !rd->active || !lines || !text) return 0;
+
+    size_t count = 0;
+    size_t used = 0;
+
+    while (count < max_lines && used < text_size) {
+        size_t cap = text_size - used;
+        uint32_t pos = rd->pos;
+        log_rec_hdr_t hdr;
+        size_t len;
+
+        line_status_t st = next_line(&pos, &hdr, text + used, cap, &len,
+                                     rd->match.active ? &rd->match : NULL);
+        if (st == LINE_NONE) {
+            rd->pos = pos;      // Keep any pad skip / resync
+            break;
+        }
+        if (st == LINE_SKIPPED) {
+            uint32_t gap;
+            account_line(rd, &hdr, &gap);
+            rd->pending_gap += gap;
+            rd->pos = pos;
+            continue;
+        }
+
+        if (len > cap) {
+            if (count > 0) break;   // Leave it for the next call
+            len = cap;
+        }
+
+        log_line_t *ln = &lines[count];
+        ln->seq = account_line(rd, &hdr, &ln->gap);
+        ln->gap += rd->pending_gap;
+        rd->pending_gap = 0;
+        ln->ts_us = hdr.ts_us;
+        ln->offset = (uint32_t)used;
+        ln->len = (uint32_t)len;
+        note_line_ts(rd, &hdr);
+
+        used += len;
+        rd->pos = pos;
+        count++;
+    }
+
+    return count;
+}
+
+void log_buffer_set_filter(int reader_id, const log_filter_t *filter)
+{
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd) return;
+    match_compile(&rd->match, filter);
+}
+
+bool log_buffer_seek(int reader_id, uint64_t seq)
+{
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd || !rd->active) return false;
+
+    // Walk from the oldest line to the first one at or after seq
+    uint32_t pos = find_oldest();
+    log_rec_hdr_t hdr;
+    size_t len;
+
+    while (next_line(&pos, &hdr, NULL, 0, &len, NULL)) {
+        uint64_t s = seq_extend(hdr.seq);
+        if (s >= seq) {
+            rd->pos = pos_sub(pos, rec_size(hdr.len));
+            rd->next_seq = seq;     // Anything between seq and s is a gap
+            rd->synced = true;
+            return s == seq;
+        }
+    }
+
+    // Caught up: seq is the next line, or one not written yet
+    rd->pos = pos;
+    rd->next_seq = seq;
+    rd->synced = (seq <= head_seq());
+    return true;
+}
+
+uint64_t log_buffer_head_seq(void)
+{
+    return head_seq();
+}
+
+bool log_buffer_wait(int reader_id, uint32_t timeout_ms)
+{
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd || !rd->active) return false;
+
+    // Announce, then re-check, so a line committed in between isn't missed
+    __atomic_store_n(&rd->waiting, true, __ATOMIC_SEQ_CST);
+    if (!log_buffer_has_data(reader_id)) {
+        xSemaphoreTake(rd->wake, pdMS_TO_TICKS(timeout_ms));
+    }
+    __atomic_store_n(&rd->waiting, false, __ATOMIC_RELEASE);
+
+    return log_buffer_has_data(reader_id);
+}
+
+bool log_buffer_wait_any(const int *reader_ids, size_t count, uint32_t timeout_ms)
+{
+    if (!s_any_wake) return false;
+
+    // Same announce/re-check as log_buffer_wait(), against the whole set
+    __atomic_store_n(&s_any_waiting, true, __ATOMIC_SEQ_CST);
+    for (size_t i = 0; i < count; i++) {
+        if (log_buffer_has_data(reader_ids[i])) {
+            __atomic_store_n(&s_any_waiting, false, __ATOMIC_RELEASE);
+            return true;
+        }
+    }
+    bool woken = xSemaphoreTake(s_any_wake, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+    __atomic_store_n(&s_any_waiting, false, __ATOMIC_RELEASE);
+
+    return woken;
+}
+
+void log_buffer_wake_any(void)
+{
+    if (s_any_wake) {
+        __atomic_store_n(&s_any_waiting, false, __ATOMIC_RELEASE);
+        xSemaphoreGive(s_any_wake);
+    }
+}
+
+void log_buffer_mark_delivered(int reader_id, size_t bytes)
+{
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd) return;
+
+    rd->bytes_sent += bytes;
+    if (!rd->ts_pending) return;
+    rd->ts_pending = false;
+
+    uint32_t lat = (uint32_t)esp_timer_get_time() - rd->line_ts_us;
+
+    rd->lat_samples++;
+    rd->lat_sum_us += lat;
+    if (lat > rd->lat_max_us) {
+        rd->lat_max_us = lat;
+    }
+
+    // Statistics only: no lock
+    s_lat_last_us = lat;
+    s_lat_sum_us += lat;
+    s_lat_samples++;
+    if (lat > s_lat_max_us) {
+        s_lat_max_us = lat;
+    }
+}
+
+void log_buffer_skip_to_head(int reader_id)
+{
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd) return;
+
+    rd->pos = head_pos();
+    rd->synced = false;     // Skipped lines are not "missed"
+}
+
+uint32_t log_buffer_reader_lag(int reader_id)
 {
-    if (!s_mutex) return 0;
+    log_reader_t *rd = get_reader(reader_id);
+    if (!rd || !rd->active) return 0;
 
+    uint32_t lag = pos_diff(head_pos(), rd->pos);
+    return (lag > LOG_BUFFER_BYTES) ? LOG_BUFFER_BYTES : lag;
+}
+
+uint32_t log_buffer_reader_missed(int reader_id)
+{
+    log_reader_t *rd = get_reader(reader_id);
+    return rd ? rd->missed : 0;
+}
+
+size_t log_buffer_get_reader_stats(log_reader_stats_t *out, size_t max)
+{
+    if (!out || !s_mutex) return 0;
+    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return 0;
+
+    size_t n = 0;
+    for (int i = 0; i < s_reader_slots && n < max; i++) {
+        log_reader_t *rd = s_readers[i];
+        if (!rd->active) continue;
+
+        log_reader_stats_t *st = &out[n++];
+        st->id = i;
+        memcpy(st->name, rd->name, sizeof(st->name));
+        st->lag_bytes = log_buffer_reader_lag(i);
+        st->missed = rd->missed;
+        st->lines = rd->lines;
+        st->bytes_sent = rd->bytes_sent;
+        st->latency_avg_us = rd->lat_samples ? (uint32_t)(rd->lat_sum_us / rd->lat_samples) : 0;
+        st->latency_max_us = rd->lat_max_us;
+    }
+
+    xSemaphoreGive(s_mutex);
+    return n;
+}
+
+uint32_t log_buffer_get_dropped(void)
+{
+    return __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
+
+int log_buffer_get_count(void)
+{
     int count = 0;
+    uint32_t pos = find_oldest();
+    log_rec_hdr_t hdr;
 
-    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        count = (s_total_written < LOG_BUFFER_LINES) ? s_total_written : LOG_BUFFER_LINES;
-        xSemaphoreGive(s_mutex);
+    size_t len;
+
+    while (next_line(&pos, &hdr, NULL, 0, &len, NULL)) {
+        count++;
     }
 
     return count;
 }
 
-size_t log_buffer_get_all(char *out_buf, size_t buf_size)
+void log_buffer_get_stats(log_buffer_stats_t *out)
 {
-    if (!s_mutex || !out_buf || buf_size == 0) return 0;
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    out->capacity_bytes = LOG_BUFFER_BYTES;
 
-    size_t written = 0;
+    // Walk what is in the ring now
+    uint32_t start = find_oldest();
+    uint32_t pos = start;
+    uint32_t text_bytes = 0;
+    log_rec_hdr_t hdr;
+    size_t len;
 
-    if (xSemaphoreTake(s_mutex, pdMS_TO_TICKS(500)) == pdTRUE) {
-        // How many lines do we have?
-        int num_lines = (s_total_written < LOG_BUFFER_LINES) ? s_total_written : LOG_BUFFER_LINES;
-
-        if (num_lines > 0) {
-            // Find the oldest line in the buffer
-            int start_idx;
-            if (s_total_written <= LOG_BUFFER_LINES) {
-                start_idx = 0;  // Haven't wrapped yet
-            } else {
-                start_idx = s_write_idx;  // Oldest is at write position (about to be overwritten)
-            }
+    while (next_line(&pos, &hdr, NULL, 0, &len, NULL)) {
+        out->lines++;
+        text_bytes += hdr.len;
+    }
 
-            // Copy each line
-            for (int i = 0; i < num_lines && written < buf_size - 2; i++) {
-                int buf_idx = (start_idx + i) % LOG_BUFFER_LINES;
-                size_t line_len = s_log_lengths[buf_idx];
+    out->bytes_used = pos_diff(pos, start);
+    out->total_lines = (uint32_t)(__atomic_load_n(&s_state, __ATOMIC_ACQUIRE) >> 32);
+    out->evicted_lines = out->total_lines - out->lines;
+    out->dropped_lines = log_buffer_get_dropped();
+    if (out->lines > 0) {
+        out->avg_line_bytes = text_bytes / out->lines;
+    }
 
-                // Check if we have room
-                if (written + line_len + 1 >= buf_size) {
-                    break;  // No more room
-                }
+    out->reader_slots = (uint32_t)__atomic_load_n(&s_reader_slots, __ATOMIC_ACQUIRE);
+    out->reader_max = CONFIG_LOG_MAX_READERS;
 
-                // Copy line
-                memcpy(out_buf + written, s_log_buffer[buf_idx], line_len);
-                written += line_len;
+    out->latency_samples = s_lat_samples;
+    out->latency_last_us = s_lat_last_us;
+    out->latency_max_us = s_lat_max_us;
+    if (s_lat_samples > 0) {
+        out->latency_avg_us = (uint32_t)(s_lat_sum_us / s_lat_samples);
+    }
+
+    // Lines the ring holds once full, at the average line length it holds now
+    if (out->avg_line_bytes > 0) {
+        out->est_capacity_lines = LOG_BUFFER_BYTES / rec_size(out->avg_line_bytes);
+    }
+}
+
+void log_buffer_cursor_init(log_cursor_t *cur, uint32_t tail)
+{
+    if (!cur) return;
+    memset(cur, 0, sizeof(*cur));
 
-                // Add newline
-                out_buf[written++] = '\n';
+    cur->end_seq = head_seq();
+    uint64_t first = (tail && tail < cur->end_seq) ? cur->end_seq - tail : 0;
+
+    // Walk from the oldest line to the first one at or after first
+    uint32_t pos = find_oldest();
+    log_rec_hdr_t hdr;
+    size_t len;
+
+    cur->pos = pos;
+    cur->next_seq = cur->end_seq;
+    while (next_line(&pos, &hdr, NULL, 0, &len, NULL)) {
+        uint64_t seq = seq_extend(hdr.seq);
+        if (seq >= first) {
+            cur->pos = pos_sub(pos, rec_size(hdr.len));
+            cur->next_seq = seq;
+            return;
+        }
+        cur->pos = pos;
+    }
+}
+
+size_t log_buffer_read_text(log_cursor_t *cur, char *buf, size_t size, const log_filter_t *filter)
+{
+    if (!cur || !buf || size < 2) return 0;
+
+    log_match_t match;
+    match_compile(&match, filter);
+
+    size_t written = 0;
+    while (written < size - 1) {
+        size_t room = size - written - 1;   // Keep one byte for the newline
+        uint32_t pos = cur->pos;
+        log_rec_hdr_t hdr;
+        size_t len;
+
+        line_status_t st = next_line(&pos, &hdr, buf + written, room, &len,
+                                     match.active ? &match : NULL);
+        if (st == LINE_NONE) {
+            cur->pos = pos;     // Keep any pad skip / resync
+            break;
+        }
+
+        uint64_t seq = seq_extend(hdr.seq);
+        if (seq >= cur->end_seq) {
+            // Done, or lapped: then the rest of the dump was overwritten
+            if (cur->next_seq < cur->end_seq) {
+                cur->lost += (uint32_t)(cur->end_seq - cur->next_seq);
+                cur->next_seq = cur->end_seq;
             }
+            break;
+        }
+        if (st == LINE_OK && len > room) {
+            if (written > 0) break;     // Leave it for the next call
+            len = room;
         }
 
-        xSemaphoreGive(s_mutex);
+        if (seq > cur->next_seq) {
+            cur->lost += (uint32_t)(seq - cur->next_seq);
+        }
+        cur->next_seq = seq + 1;
+        cur->pos = pos;
+
+        if (st == LINE_SKIPPED) {
+            continue;
+        }
+        written += len;
+        buf[written++] = '\n';
+        cur->lines++;
     }
 
-    // Null terminate
-    if (written < buf_size) {
-        out_buf[written] = '\0';
-    } else {
-        out_buf[buf_size - 1] = '\0';
+    return written;
+}
+
+size_t log_buffer_get_all(char *out_buf, size_t buf_size, const log_filter_t *filter)
+{
+    if (!out_buf || buf_size == 0) return 0;
+
+    out_buf[0] = '\0';
+    if (buf_size < 3) return 0;
+
+    log_cursor_t cur;
+    log_buffer_cursor_init(&cur, 0);
+
+    size_t written = 0;
+    size_t n;
+    while ((n = log_buffer_read_text(&cur, out_buf + written, buf_size - written - 1, filter)) > 0) {
+        written += n;
     }
 
+    // Null terminate
+    out_buf[written] = '\0';
+
     return written;
 }
@@ -5,13 +5,34 @@
 
 #pragma once
 
+#include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define LOG_FILTER_MAX_TAGS     4
+#define LOG_FILTER_TAG_LEN      16
+#define LOG_FILTER_GREP_LEN     32
+
+/**
+ * @brief Server-side line filter; an empty field matches every line
+ *
+ * Level and tag are recorded with each line when it is logged, so lines
+ * that fail them are skipped without being formatted. Only grep needs the
+ * text. Lines that aren't ESP_LOG output have no level or tag and fail
+ * those checks.
+ */
+typedef struct {
+    uint8_t max_level;      // esp_log_level_t: this severity or worse (0 = any)
+    uint8_t tag_count;      // Number of entries in tags (any one matches)
+    char tags[LOG_FILTER_MAX_TAGS][LOG_FILTER_TAG_LEN];
+    char grep[LOG_FILTER_GREP_LEN];     // Substring of the line text
+} log_filter_t;
+
 /**
  * @brief Initialize the log buffer
  * Call this before any logging occurs.
@@ -20,58 +41,319 @@ void log_buffer_init(void);
 
 /**
  * @brief Add a log line to the buffer
- * Thread-safe. Called from the custom vprintf.
+ * Lock-free and safe from any task on either core; never blocks and never
+ * waits for readers. Called from the custom vprintf.
  *
  * @param line  Log line (will be copied)
  * @param len   Length of the line
  */
 void log_buffer_add(const char *line, size_t len);
 
+/**
+ * @brief Add a log line without formatting it
+ *
+ * Stores the format pointer and raw arguments (see log_fmt.h); the text is
+ * rendered only when a reader consumes the line. Same concurrency
+ * guarantees as log_buffer_add().
+ *
+ * @param fmt   printf format string (must be in flash)
+ * @param args  Arguments (consumed)
+ * @return false if the line can't be packed; format it and call
+ *         log_buffer_add() instead
+ */
+bool log_buffer_add_packed(const char *fmt, va_list args);
+
 /**
  * @brief Get the next log line for a specific reader
  *
  * Each SSE client has a reader_id to track their position.
  * Returns NULL if no new logs available.
  *
- * @param reader_id  Unique ID for this reader (0-3)
+ * @param reader_id  Unique ID for this reader
  * @param out_len    Output: length of returned string
  * @return Pointer to log line (valid until next call) or NULL
  */
 const char *log_buffer_read(int reader_id, size_t *out_len);
 
 /**
- * @brief Allocate a reader ID for a new SSE client
- * @return Reader ID (0-3) or -1 if no slots available
+ * @brief Block until the reader has data or the timeout expires
+ *
+ * Writers wake the reader as soon as a line is committed, so a streamed
+ * line is not held back by a polling interval. Spurious early returns are
+ * possible; callers loop.
+ *
+ * @param reader_id   Reader ID
+ * @param timeout_ms  Maximum time to block
+ * @return true if data is available
+ */
+bool log_buffer_wait(int reader_id, uint32_t timeout_ms);
+
+/**
+ * @brief Block until any of several readers has data or the timeout expires
+ *
+ * For one task serving many readers. Only one task may wait this way at a
+ * time. Spurious early returns are possible (any committed line, or
+ * log_buffer_wake_any(), ends the wait); callers loop.
+ *
+ * @param reader_ids  Readers to watch
+ * @param count       Number of entries in reader_ids (may be 0: just sleep)
+ * @param timeout_ms  Maximum time to block
+ * @return true if woken before the timeout
+ */
+bool log_buffer_wait_any(const int *reader_ids, size_t count, uint32_t timeout_ms);
+
+/**
+ * @brief End a log_buffer_wait_any() early, e.g. when its reader set changes
+ *
+ * If nobody is waiting, the next log_buffer_wait_any() returns at once.
+ */
+void log_buffer_wake_any(void);
+
+/**
+ * @brief Record that the lines returned to this reader since the last call
+ *        reached their sink
+ *
+ * Feeds the write-to-delivery latency in log_buffer_get_stats() (the
+ * latency of the oldest of those lines) and the reader's bytes_sent.
+ *
+ * @param reader_id  Reader ID
+ * @param bytes      Bytes the sink accepted, framing included
+ */
+void log_buffer_mark_delivered(int reader_id, size_t bytes);
+
+/**
+ * @brief Lines this reader has missed so far
+ *
+ * Counts lines that were overwritten before the reader got to them
+ * (it fell more than a full ring behind). Never decreases.
+ */
+uint32_t log_buffer_reader_missed(int reader_id);
+
+/**
+ * @brief Move a reader to the newest position, discarding what it hadn't read
+ *
+ * The skipped lines are not counted as missed.
+ */
+void log_buffer_skip_to_head(int reader_id);
+
+/**
+ * @brief Ring bytes written that this reader hasn't consumed yet
+ *
+ * Capped at the ring size (a reader that far behind is losing lines).
  */
-int log_buffer_alloc_reader(void);
+uint32_t log_buffer_reader_lag(int reader_id);
 
 /**
- * @brief Free a reader ID when SSE client disconnects
+ * @brief Lines lost because the ring turned over while they were being written
+ */
+uint32_t log_buffer_get_dropped(void);
+
+/**
+ * @brief Copy as many pending lines as fit into buf, each wrapped in
+ *        prefix/suffix (e.g. "data: " / "\n\n" for SSE)
+ *
+ * Only whole lines are copied; a line that doesn't fit stays pending for
+ * the next call. The batch stops before a gap in the sequence, so
+ * log_buffer_reader_missed() can be reported between batches. Not
+ * NUL-terminated.
+ *
+ * @param reader_id  Reader ID
+ * @param buf        Output buffer (should hold at least one full line)
+ * @param size       Buffer size
+ * @param prefix     Written before each line (may be NULL)
+ * @param suffix     Written after each line (may be NULL)
+ * @param out_lines  Output: number of lines copied (may be NULL)
+ * @return Bytes written, 0 if no new logs available
+ */
+size_t log_buffer_read_batch(int reader_id, char *buf, size_t size,
+                             const char *prefix, const char *suffix, uint32_t *out_lines);
+
+/**
+ * @brief One line returned by log_buffer_read_lines()
+ */
+typedef struct {
+    uint64_t seq;           // Sequence number; counts from boot, never reused
+    uint32_t ts_us;         // esp_timer time of the write (low 32 bits)
+    uint32_t gap;           // Lines lost just before this one (reader was lapped)
+    uint32_t offset;        // Start of the text in the caller's buffer
+    uint32_t len;           // Text length (not NUL-terminated)
+} log_line_t;
+
+/**
+ * @brief Copy pending lines and their metadata into caller buffers
+ *
+ * Texts are packed back to back into text; lines[i].offset/len locate
+ * each one. Nothing returned points into the ring, so the result stays
+ * valid however many lines are logged meanwhile. Unlike
+ * log_buffer_read_batch() a gap doesn't end the batch: it is reported on
+ * the first line after it (and counted in log_buffer_reader_missed()).
+ *
+ * @param reader_id  Reader ID
+ * @param lines      Output: line descriptors
+ * @param max_lines  Capacity of lines
+ * @param text       Output: line texts
+ * @param text_size  Capacity of text (should hold at least one full line)
+ * @return Number of lines copied, 0 if none pending
+ */
+size_t log_buffer_read_lines(int reader_id, log_line_t *lines, size_t max_lines,
+                             char *text, size_t text_size);
+
+/**
+ * @brief Only return lines matching filter to this reader (NULL: all lines)
+ *
+ * Lines filtered out are not gaps; lines lost to a lap still are.
+ */
+void log_buffer_set_filter(int reader_id, const log_filter_t *filter);
+
+/**
+ * @brief Position a reader so the next line it reads is seq
+ *
+ * If seq is older than anything still held, the reader starts at the
+ * oldest line and the lines in between are reported as a gap (and counted
+ * as missed). If seq hasn't been written yet the reader waits for it.
+ *
+ * @param reader_id  Reader ID
+ * @param seq        Sequence number of the first line wanted
+ * @return false if lines from seq on were already overwritten
+ */
+bool log_buffer_seek(int reader_id, uint64_t seq);
+
+/**
+ * @brief Sequence number the next logged line will get
+ */
+uint64_t log_buffer_head_seq(void);
+
+#define LOG_READER_NAME_LEN     16
+
+/**
+ * @brief Allocate a reader ID for a new client (SSE stream, CDC drain)
+ *
+ * Reader state is allocated from the heap on first use and reused after
+ * log_buffer_free_reader(); at most CONFIG_LOG_MAX_READERS exist.
+ *
+ * @param name  Shown in log_buffer_get_reader_stats() (e.g. "sse", "cdc")
+ * @return Reader ID, or -1 if the cap is reached or the heap is exhausted
+ */
+int log_buffer_alloc_reader(const char *name);
+
+/**
+ * @brief Free a reader ID when its client disconnects
  */
 void log_buffer_free_reader(int reader_id);
 
+/**
+ * @brief Per-reader progress
+ */
+typedef struct {
+    int id;
+    char name[LOG_READER_NAME_LEN];
+    uint32_t lag_bytes;         // Ring bytes not read yet
+    uint32_t missed;            // Lines lost to laps
+    uint32_t lines;             // Lines returned
+    uint32_t bytes_sent;        // From log_buffer_mark_delivered()
+    uint32_t latency_avg_us;    // Write-to-delivery
+    uint32_t latency_max_us;
+} log_reader_stats_t;
+
+/**
+ * @brief Get stats for every active reader
+ *
+ * @param out  Output array
+ * @param max  Capacity of out
+ * @return Number of readers written
+ */
+size_t log_buffer_get_reader_stats(log_reader_stats_t *out, size_t max);
+
 /**
  * @brief Check if there are new logs for a reader
  */
 bool log_buffer_has_data(int reader_id);
 
+/**
+ * @brief Position for dumping the ring in pieces, without a reader slot
+ *
+ * Set up with log_buffer_cursor_init(); fields are read-only for callers.
+ */
+typedef struct {
+    uint32_t pos;           // Next record position
+    uint64_t next_seq;      // Sequence number of the next line
+    uint64_t end_seq;       // Head when the cursor was set up; the dump stops there
+    uint32_t lost;          // Lines overwritten before the cursor got to them
+    uint32_t lines;         // Lines returned so far
+} log_cursor_t;
+
+/**
+ * @brief Start a dump of what is buffered now
+ *
+ * Lines logged after this call are not part of the dump, so a busy logger
+ * can't keep it going forever.
+ *
+ * @param cur   Cursor to set up
+ * @param tail  Start this many lines before the head (0: oldest held line).
+ *              Counted before any filter is applied.
+ */
+void log_buffer_cursor_init(log_cursor_t *cur, uint32_t tail);
+
+/**
+ * @brief Copy the next lines of a dump, each followed by a newline
+ *
+ * Only whole lines are copied. Nothing is locked, and loggers are not
+ * held up; if the ring laps the cursor between calls the dump resumes at
+ * the oldest surviving line and the skipped lines are added to cur->lost.
+ * Not NUL-terminated.
+ *
+ * @param cur     Cursor from log_buffer_cursor_init()
+ * @param buf     Output buffer (should hold at least one full line)
+ * @param size    Buffer size
+ * @param filter  Only lines matching this (NULL: all lines)
+ * @return Bytes written, 0 once the dump is complete
+ */
+size_t log_buffer_read_text(log_cursor_t *cur, char *buf, size_t size, const log_filter_t *filter);
+
 /**
  * @brief Get all buffered logs as a single string
  *
  * Copies all logs in the buffer (oldest to newest) into the provided buffer.
- * Each log line is separated by a newline.
+ * Each log line is separated by a newline. For large dumps prefer
+ * log_buffer_read_text(), which needs no buffer the size of the ring.
  *
  * @param out_buf    Output buffer to write logs to
  * @param buf_size   Size of output buffer
+ * @param filter     Only lines matching this (NULL: all lines)
  * @return Number of bytes written (excluding null terminator)
  */
-size_t log_buffer_get_all(char *out_buf, size_t buf_size);
+size_t log_buffer_get_all(char *out_buf, size_t buf_size, const log_filter_t *filter);
 
 /**
  * @brief Get the number of lines currently in buffer
  */
 int log_buffer_get_count(void);
 
+/**
+ * @brief Log ring occupancy and history depth
+ */
+typedef struct {
+    uint32_t capacity_bytes;
+    uint32_t bytes_used;
+    uint32_t lines;                 // Lines currently held
+    uint32_t total_lines;           // Lines ever written
+    uint32_t evicted_lines;         // Lines overwritten by newer ones
+    uint32_t dropped_lines;         // Lines lost mid-write (log_buffer_get_dropped())
+    uint32_t avg_line_bytes;        // Mean ring payload per line (packed lines are smaller)
+    uint32_t est_capacity_lines;    // History depth of a full ring at that mean
+    uint32_t reader_slots;          // Reader states allocated so far
+    uint32_t reader_max;            // CONFIG_LOG_MAX_READERS
+    uint32_t latency_samples;       // Deliveries via log_buffer_mark_delivered()
+    uint32_t latency_last_us;       // Write-to-delivery latency
+    uint32_t latency_avg_us;
+    uint32_t latency_max_us;
+} log_buffer_stats_t;
+
+/**
+ * @brief Get log ring statistics
+ */
+void log_buffer_get_stats(log_buffer_stats_t *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,9 +30,17 @@
 #include "dhcpserver/dhcpserver_options.h"
 #include "lwip/esp_netif_net_stack.h"
 #include "lwip/ip4_addr.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
 
 #include "network_setup.h"
 #include "event_log.h"
+#include "frame_pool.h"
+#include "spsc_ring.h"
+#include "pkt_classify.h"
+#if CONFIG_NCM_PCAP_CAPTURE
+#include "pcap_capture.h"
+#endif
 
 static const char *TAG = "net";
 
@@ -48,15 +56,111 @@ static const char *TAG = "net";
 #define USB_RECOVER_BACKOFF_START_MS  2500
 #define USB_RECOVER_BACKOFF_MAX_MS    15000
 
+#define NCM_RX_FRAME_MAX              1536    // >= Ethernet MTU frame (1514) + VLAN tag, word aligned
+#define NCM_RX_RING_SIZE              64      // power of two >= max CONFIG_NCM_RX_POOL_FRAMES
+#define NCM_RX_WORKER_STACK           4096
+#define NCM_TX_FRAME_MAX              1536
+#define NCM_TX_RING_SIZE              32      // power of two >= max CONFIG_NCM_TX_QUEUE_FRAMES
+#define NCM_TX_SENDER_STACK           3072
+
 // ----------------------------
 // State
 // ----------------------------
 static esp_netif_t *s_netif = NULL;
 
-static uint32_t s_rx_packets = 0;
-static uint32_t s_tx_packets = 0;
-static uint32_t s_rx_bytes = 0;
-static uint32_t s_tx_bytes = 0;
+// Traffic counters: 64-bit, one shard per core, each shard guarded by a
+// sequence count so readers on the other core get a tear-free snapshot.
+// Writers mask interrupts on their own core, so a shard never has two
+// writers at once and the hot path takes no lock.
+typedef enum {
+    NET_CTR_RX_PACKETS,
+    NET_CTR_RX_BYTES,
+    NET_CTR_RX_BYTES_COPIED,
+    NET_CTR_RX_DROP_NOT_READY,
+    NET_CTR_RX_DROP_OVERSIZE,
+    NET_CTR_RX_DROP_NO_BUFFER,
+    NET_CTR_RX_DROP_RING_FULL,
+    NET_CTR_RX_ERRORS,
+    NET_CTR_TX_PACKETS,
+    NET_CTR_TX_BYTES,
+    NET_CTR_TX_DROP_NOT_READY,
+    NET_CTR_TX_DROP_OVERSIZE,
+    NET_CTR_TX_DROP_QUEUE_FULL,
+    NET_CTR_TX_DROP_LINK_DOWN,
+    NET_CTR_TX_DROP_USB_TIMEOUT,
+    NET_CTR_TX_DROP_USB_ERROR,
+    NET_CTR_TX_RETRIES,
+    NET_CTR_TX_AGG_FLUSHES,
+    NET_CTR_TX_AGG_DATAGRAMS,
+    NET_CTR_TX_AGG_BYPASS,
+    NET_CTR_COUNT
+} net_ctr_t;
+
+typedef struct {
+    uint32_t seq;                   // odd while an update is in progress
+    uint64_t v[NET_CTR_COUNT];
+} net_ctr_shard_t;
+
+static net_ctr_shard_t s_ctr[portNUM_PROCESSORS];
+
+// RX frame pool: every inbound frame lands in one of these and is returned
+// by lwIP through rx_pbuf_free() (custom pbuf mode) or driver_free_rx_buffer
+// (l2_free, esp-netif mode).
+typedef struct {
+#if CONFIG_NCM_RX_MODE_PBUF_CUSTOM
+    struct pbuf_custom pc;      // must stay first: lwIP hands &pc back on free
+#endif
+    uint16_t len;
+    uint8_t data[NCM_RX_FRAME_MAX] __attribute__((aligned(4)));
+} rx_frame_t;
+
+static rx_frame_t s_rx_frames[CONFIG_NCM_RX_POOL_FRAMES];
+static uint16_t s_rx_free_stack[CONFIG_NCM_RX_POOL_FRAMES];
+static frame_pool_t s_rx_pool;
+
+// TX queue: lwIP copies outbound frames into these and tx_sender_task
+// pushes them to TinyUSB.
+typedef struct {
+    int64_t enqueued_us;        // for the submit-to-complete histogram
+    uint16_t len;
+    uint8_t data[NCM_TX_FRAME_MAX] __attribute__((aligned(4)));
+} tx_frame_t;
+
+static tx_frame_t s_tx_frames[CONFIG_NCM_TX_QUEUE_FRAMES];
+static uint16_t s_tx_free_stack[CONFIG_NCM_TX_QUEUE_FRAMES];
+static frame_pool_t s_tx_pool;
+static void *s_tx_ring_slots[NCM_TX_RING_SIZE];
+static spsc_ring_t s_tx_ring;
+static TaskHandle_t s_tx_sender_task = NULL;
+static esp_timer_handle_t s_tx_agg_timer = NULL;   // Ends an aggregation window
+
+static uint32_t s_tx_agg_max_batch = 0;
+
+// Log2 histograms: bucket 0 counts zeros, bucket i counts values in
+// [2^(i-1), 2^i), the last bucket is open-ended. Each histogram has a single
+// writer task; buckets are bumped with relaxed atomics so readers never need
+// a lock.
+#define NET_HIST_BUCKETS  24
+
+typedef struct {
+    uint32_t b[NET_HIST_BUCKETS];
+} net_hist_t;
+
+static net_hist_t s_hist_rx_size;       // TinyUSB task
+static net_hist_t s_hist_tx_size;       // lwIP thread
+static net_hist_t s_hist_rx_gap_us;     // TinyUSB task
+static net_hist_t s_hist_tx_gap_us;     // lwIP thread
+static net_hist_t s_hist_tx_latency_us; // USB sender: netif_transmit -> TinyUSB accepted
+
+static int64_t s_last_rx_us = 0;
+static int64_t s_last_tx_us = 0;
+
+#if CONFIG_NCM_RX_WORKER
+// TinyUSB task -> RX worker hand-off (frames only, never more than the pool)
+static void *s_rx_ring_slots[NCM_RX_RING_SIZE];
+static spsc_ring_t s_rx_ring;
+static TaskHandle_t s_rx_worker_task = NULL;
+#endif
 
 static bool s_first_rx_logged = false;
 static bool s_first_tx_logged = false;
@@ -78,6 +182,75 @@ static inline uint32_t now_ms(void) {
     return (uint32_t)(esp_timer_get_time() / 1000);
 }
 
+// ----------------------------
+// Counters
+// ----------------------------
+static inline void ctr_add2(net_ctr_t a, uint64_t da, net_ctr_t b, uint64_t db)
+{
+    UBaseType_t irq = portSET_INTERRUPT_MASK_FROM_ISR();
+    net_ctr_shard_t *sh = &s_ctr[xPortGetCoreID()];
+
+    __atomic_store_n(&sh->seq, sh->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    sh->v[a] += da;
+    sh->v[b] += db;
+    __atomic_store_n(&sh->seq, sh->seq + 1, __ATOMIC_RELEASE);
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(irq);
+}
+
+static inline void ctr_add(net_ctr_t c, uint64_t d)
+{
+    ctr_add2(c, d, c, 0);
+}
+
+static inline void ctr_inc(net_ctr_t c)
+{
+    ctr_add2(c, 1, c, 0);
+}
+
+/**
+ * Sum all shards into out[]. Each shard is copied under its sequence count
+ * and retried if a writer on the other core raced the copy.
+ */
+static void ctr_snapshot(uint64_t out[NET_CTR_COUNT])
+{
+    memset(out, 0, sizeof(uint64_t) * NET_CTR_COUNT);
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        net_ctr_shard_t *sh = &s_ctr[core];
+        uint64_t v[NET_CTR_COUNT];
+        uint32_t begin, end;
+
+        do {
+            begin = __atomic_load_n(&sh->seq, __ATOMIC_ACQUIRE);
+            memcpy(v, sh->v, sizeof(v));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            end = __atomic_load_n(&sh->seq, __ATOMIC_RELAXED);
+        } while ((begin & 1) || begin != end);
+
+        for (int i = 0; i < NET_CTR_COUNT; i++) {
+            out[i] += v[i];
+        }
+    }
+}
+
+static inline void hist_add(net_hist_t *h, uint32_t value)
+{
+    uint32_t i = value ? (uint32_t)(32 - __builtin_clz(value)) : 0;
+    if (i >= NET_HIST_BUCKETS) i = NET_HIST_BUCKETS - 1;
+    __atomic_fetch_add(&h->b[i], 1, __ATOMIC_RELAXED);
+}
+
+static inline void hist_add_gap(net_hist_t *h, int64_t *last_us, int64_t now)
+{
+    if (*last_us != 0) {
+        int64_t gap = now - *last_us;
+        hist_add(h, gap > UINT32_MAX ? UINT32_MAX : (uint32_t)gap);
+    }
+    *last_us = now;
+}
+
 // ----------------------------
 // IP config
 // ----------------------------
@@ -113,7 +286,82 @@ static void usb_set_link_state(bool up, const char *reason)
 static void l2_free(void *h, void *buffer)
 {
     (void)h;
-    free(buffer);
+    if (!buffer) return;
+
+    // rx_deliver() always passes the pool frame as the eb, and esp-netif
+    // (IDF 5.1+) frees the eb rather than the payload when one was given
+    frame_pool_free(&s_rx_pool, (rx_frame_t *)buffer);
+}
+
+#if CONFIG_NCM_RX_MODE_PBUF_CUSTOM
+static void rx_pbuf_free(struct pbuf *p)
+{
+    frame_pool_free(&s_rx_pool, (rx_frame_t *)p);
+}
+
+/**
+ * lwIP input hook used instead of ethernetif_input(). The pool frame arrives
+ * as the esp-netif "eb" argument and is wrapped in the pbuf_custom it carries,
+ * so lwIP reads the payload in place.
+ */
+static void ncm_netif_input(void *h, void *buffer, size_t len, void *eb)
+{
+    struct netif *netif = (struct netif *)h;
+    rx_frame_t *frame = (rx_frame_t *)eb;
+
+    if (!frame) return;
+
+    if (!netif_is_up(netif)) {
+        frame_pool_free(&s_rx_pool, frame);
+        return;
+    }
+
+    frame->pc.custom_free_function = rx_pbuf_free;
+    struct pbuf *p = pbuf_alloced_custom(PBUF_RAW, (u16_t)len, PBUF_REF, &frame->pc,
+                                         buffer, NCM_RX_FRAME_MAX);
+    if (!p) {
+        frame_pool_free(&s_rx_pool, frame);
+        return;
+    }
+
+    // On error the pbuf is still ours; freeing it returns the frame to the pool.
+    if (netif->input(p, netif) != ERR_OK) {
+        pbuf_free(p);
+    }
+}
+#endif
+
+/**
+ * Map a classified DHCP message to the event log. RX carries client messages
+ * (DISCOVER/REQUEST), TX carries our server replies (OFFER/ACK).
+ */
+static void record_dhcp_event(const pkt_info_t *info, bool tx)
+{
+    if (info->app != PKT_APP_DHCP) return;
+
+    switch (info->dhcp_msg) {
+        case PKT_DHCP_DISCOVER:
+            if (!tx) event_log_record(EVT_DHCP_DISCOVER_RX, NULL);
+            break;
+        case PKT_DHCP_REQUEST:
+            if (!tx) event_log_record(EVT_DHCP_REQUEST_RX, NULL);
+            break;
+        case PKT_DHCP_OFFER:
+            if (tx) event_log_record(EVT_DHCP_OFFER_TX, NULL);
+            break;
+        case PKT_DHCP_ACK:
+            if (tx) {
+                char ip[16];
+                snprintf(ip, sizeof(ip), "%u.%u.%u.%u",
+                         info->dhcp_yiaddr[0], info->dhcp_yiaddr[1],
+                         info->dhcp_yiaddr[2], info->dhcp_yiaddr[3]);
+                event_log_record(EVT_DHCP_ACK_TX, NULL);
+                event_log_record(EVT_DHCP_ASSIGNED, ip);
+            }
+            break;
+        default:
+            break;
+    }
 }
 
 // ----------------------------
@@ -184,101 +432,302 @@ static void on_usb_net_init(void *ctx)
     ESP_LOGW(TAG, "*** on_usb_net_init() called (rare on NCM) ***");
 }
 
+/**
+ * Deliver one pool frame to lwIP (and the event log). Runs on the RX worker
+ * when CONFIG_NCM_RX_WORKER is set, otherwise inline on the TinyUSB task.
+ */
+static void rx_deliver(rx_frame_t *frame)
+{
+    const uint8_t *eth = frame->data;
+    uint16_t len = frame->len;
+
+    if (!s_first_rx_logged) {
+        s_first_rx_logged = true;
+        event_log_record(EVT_FIRST_RX, NULL);
+    }
+
+    pkt_info_t info;
+    pkt_classify(eth, len, &info);
+    record_dhcp_event(&info, false);
+#if CONFIG_NCM_PCAP_CAPTURE
+    pcap_capture_frame(eth, len, &info);
+#endif
+
+    // The frame is the eb: it comes back whole to l2_free() / rx_pbuf_free()
+    esp_err_t ret = esp_netif_receive(s_netif, frame->data, len, frame);
+    if (ret != ESP_OK) {
+        ctr_inc(NET_CTR_RX_ERRORS);
+        ESP_LOGW(TAG, "RX: esp_netif_receive failed: %s", esp_err_to_name(ret));
+    }
+}
+
+#if CONFIG_NCM_RX_WORKER
+static void rx_worker_task(void *arg)
+{
+    (void)arg;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        rx_frame_t *frame;
+        while ((frame = spsc_ring_pop(&s_rx_ring)) != NULL) {
+            rx_deliver(frame);
+        }
+    }
+}
+#endif
+
+/**
+ * TinyUSB RX callback (TinyUSB task). Keep this short: copy the datagram out
+ * of the NTB into a pool frame and hand it off; everything else happens in
+ * rx_deliver().
+ */
 static esp_err_t netif_recv_callback(void *buffer, uint16_t len, void *ctx)
 {
     (void)ctx;
 
     if (!s_netif) {
         ESP_LOGW(TAG, "RX: netif not ready, dropping");
+        ctr_inc(NET_CTR_RX_DROP_NOT_READY);
         return ESP_OK;
     }
 
-    s_rx_packets++;
-    s_rx_bytes += len;
+    ctr_add2(NET_CTR_RX_PACKETS, 1, NET_CTR_RX_BYTES, len);
 
-    uint32_t t = now_ms();
-    s_last_rx_ms = t;
+    int64_t now_us = esp_timer_get_time();
+    s_last_rx_ms = (uint32_t)(now_us / 1000);
+    hist_add(&s_hist_rx_size, len);
+    hist_add_gap(&s_hist_rx_gap_us, &s_last_rx_us, now_us);
 
-    if (!s_first_rx_logged) {
-        s_first_rx_logged = true;
-        event_log_record(EVT_FIRST_RX, NULL);
+    // Must copy - TinyUSB reuses RX buffer. Copy into a pool frame instead of
+    // the heap; lwIP hands it back through l2_free().
+    if (len > NCM_RX_FRAME_MAX) {
+        ctr_inc(NET_CTR_RX_DROP_OVERSIZE);
+        return ESP_ERR_INVALID_SIZE;
     }
 
-    // quick DHCP detect for your event log
-    if (len >= 42) {
-        uint8_t *eth = (uint8_t *)buffer;
-        uint16_t ethertype = (uint16_t)((eth[12] << 8) | eth[13]);
-        if (ethertype == 0x0800) {
-            uint8_t proto = eth[23];
-            if (proto == 17) {
-                uint16_t src_port = (uint16_t)((eth[34] << 8) | eth[35]);
-                uint16_t dst_port = (uint16_t)((eth[36] << 8) | eth[37]);
-                if (src_port == 68 && dst_port == 67) {
-                    event_log_record(EVT_DHCP_DISCOVER_RX, NULL);
-                }
-            }
+    rx_frame_t *frame = frame_pool_alloc(&s_rx_pool);
+    if (!frame) {
+        // Counted, not logged: this is the hot path.
+        ctr_inc(NET_CTR_RX_DROP_NO_BUFFER);
+        return ESP_ERR_NO_MEM;
+    }
+    frame->len = len;
+    memcpy(frame->data, buffer, len);
+
+#if CONFIG_NCM_RX_MODE_ESP_NETIF && CONFIG_LWIP_L2_TO_L3_COPY
+    ctr_add(NET_CTR_RX_BYTES_COPIED, 2 * (uint64_t)len);   // ethernetif_input copies again
+#else
+    ctr_add(NET_CTR_RX_BYTES_COPIED, len);
+#endif
+
+#if CONFIG_NCM_RX_WORKER
+    if (!spsc_ring_push(&s_rx_ring, frame)) {
+        ctr_inc(NET_CTR_RX_DROP_RING_FULL);
+        frame_pool_free(&s_rx_pool, frame);
+        return ESP_ERR_NO_MEM;
+    }
+    xTaskNotifyGive(s_rx_worker_task);
+#else
+    rx_deliver(frame);
+#endif
+    return ESP_OK;
+}
+
+/**
+ * Push one queued frame to TinyUSB, retrying on timeout. Returns the frame
+ * to the pool.
+ */
+static void tx_send_frame(tx_frame_t *frame)
+{
+    static uint32_t s_fail_streak = 0;
+
+    if (!s_usb_mounted || !s_link_up) {
+        ctr_inc(NET_CTR_TX_DROP_LINK_DOWN);
+        frame_pool_free(&s_tx_pool, frame);
+        return;
+    }
+
+    esp_err_t ret = ESP_FAIL;
+    for (int attempt = 0; attempt <= CONFIG_NCM_TX_SEND_RETRIES; attempt++) {
+        if (attempt > 0) {
+            ctr_inc(NET_CTR_TX_RETRIES);
         }
+        ret = tinyusb_net_send_sync(frame->data, frame->len, NULL,
+                                    pdMS_TO_TICKS(CONFIG_NCM_TX_SEND_TIMEOUT_MS));
+        if (ret == ESP_OK || ret == ESP_ERR_INVALID_STATE) break;
     }
 
-    // Must copy - TinyUSB reuses RX buffer
-    void *buf_copy = malloc(len);
-    if (!buf_copy) {
-        ESP_LOGE(TAG, "RX: malloc(%u) failed", len);
-        return ESP_ERR_NO_MEM;
+    if (ret == ESP_OK) {
+        hist_add(&s_hist_tx_latency_us, (uint32_t)(esp_timer_get_time() - frame->enqueued_us));
+        ctr_add2(NET_CTR_TX_PACKETS, 1, NET_CTR_TX_BYTES, frame->len);
+        s_fail_streak = 0;
+    } else {
+        if (ret == ESP_ERR_TIMEOUT) {
+            ctr_inc(NET_CTR_TX_DROP_USB_TIMEOUT);
+        } else {
+            ctr_inc(NET_CTR_TX_DROP_USB_ERROR);
+        }
+        // Log the start of a failure streak only; the counters carry the rest.
+        if (s_fail_streak++ == 0) {
+            ESP_LOGW(TAG, "TX FAILED: %s", esp_err_to_name(ret));
+        }
     }
-    memcpy(buf_copy, buffer, len);
 
-    esp_err_t ret = esp_netif_receive(s_netif, buf_copy, len, NULL);
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "RX: esp_netif_receive failed: %s", esp_err_to_name(ret));
+    frame_pool_free(&s_tx_pool, frame);
+}
+
+/**
+ * Pull a batch of frames off the TX ring for back-to-back submission.
+ *
+ * TinyUSB's NCM class packs datagrams that are submitted while the IN
+ * endpoint is busy into the next NTB, so submitting frames in bursts rather
+ * than one per wakeup is what gets us multiple datagrams per NTB. A batch
+ * closes when the window expires, the byte budget is reached, or the ring
+ * runs dry after the window. A small frame arriving at an idle queue (ARP,
+ * DHCP, a lone ACK) bypasses the window entirely.
+ *
+ * The task sleeps through the window: it is woken by the producer's
+ * notification for each new frame, or by a one-shot esp_timer when the
+ * window ends. The window is usually far shorter than a tick, so it can't
+ * be a notify timeout alone, and polling would burn the CPU at the
+ * sender's priority.
+ */
+static size_t tx_collect_batch(tx_frame_t **batch, size_t max)
+{
+    size_t n = 0;
+    size_t bytes = 0;
+
+    tx_frame_t *first = spsc_ring_pop(&s_tx_ring);
+    if (!first) return 0;
+    batch[n++] = first;
+    bytes = first->len;
+
+    if (first->len <= CONFIG_NCM_TX_AGG_BYPASS_BYTES && spsc_ring_depth(&s_tx_ring) == 0) {
+        ctr_inc(NET_CTR_TX_AGG_BYPASS);
+        return n;
     }
-    return ret;
+
+    const int64_t deadline = esp_timer_get_time() + CONFIG_NCM_TX_AGG_WINDOW_US;
+    bool timer_armed = false;
+
+    while (n < max) {
+        tx_frame_t *next = spsc_ring_peek(&s_tx_ring);
+        if (next) {
+            if (bytes + next->len > CONFIG_NCM_TX_AGG_MAX_BYTES) break;
+            batch[n++] = spsc_ring_pop(&s_tx_ring);
+            bytes += next->len;
+            continue;
+        }
+
+        int64_t remaining = deadline - esp_timer_get_time();
+        if (remaining <= 0) break;
+
+        if (!timer_armed) {
+            timer_armed = (esp_timer_start_once(s_tx_agg_timer, (uint64_t)remaining) == ESP_OK);
+        }
+        // The timeout only matters if the timer couldn't be started
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(remaining / 1000) + 1);
+    }
+
+    // A batch that closed early leaves the timer running; a notification it
+    // still delivers just costs the sender one empty wakeup
+    if (timer_armed) {
+        esp_timer_stop(s_tx_agg_timer);
+    }
+
+    return n;
+}
+
+// esp_timer callback: the aggregation window is over
+static void tx_agg_window_end(void *arg)
+{
+    (void)arg;
+    xTaskNotifyGive(s_tx_sender_task);
 }
 
+/**
+ * USB sender task: drains the TX ring into TinyUSB. This is the only place
+ * that blocks on the USB IN endpoint, so a stalled host backs up the ring
+ * (and then lwIP, via ERR_MEM) instead of freezing the tcpip thread.
+ */
+static void tx_sender_task(void *arg)
+{
+    (void)arg;
+    tx_frame_t *batch[NCM_TX_RING_SIZE];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (spsc_ring_peek(&s_tx_ring)) {
+            size_t n = tx_collect_batch(batch, NCM_TX_RING_SIZE);
+
+            for (size_t i = 0; i < n; i++) {
+                tx_send_frame(batch[i]);
+            }
+
+            ctr_add2(NET_CTR_TX_AGG_FLUSHES, 1, NET_CTR_TX_AGG_DATAGRAMS, n);
+            if (n > s_tx_agg_max_batch) {
+                s_tx_agg_max_batch = n;
+            }
+        }
+    }
+}
+
+/**
+ * esp-netif transmit hook (lwIP tcpip thread, or any task holding the core
+ * lock). Never blocks: the frame is copied into a TX pool frame and queued
+ * for tx_sender_task. Producers are serialized by lwIP, which is what makes
+ * the single-producer ring safe here.
+ */
 static esp_err_t netif_transmit(void *h, void *buffer, size_t len)
 {
     (void)h;
 
     // Don't try to TX if we're not in a sane state.
     if (!s_usb_mounted || !s_link_up) {
-        return ESP_OK;
+        ctr_inc(NET_CTR_TX_DROP_NOT_READY);
+        return ESP_ERR_INVALID_STATE;
     }
 
-    s_tx_packets++;
-    s_tx_bytes += len;
-
     if (!s_first_tx_logged) {
         s_first_tx_logged = true;
         event_log_record(EVT_FIRST_TX, NULL);
     }
 
-    // crude DHCP response detection (for event log)
-    if (len >= 42) {
-        uint8_t *eth = (uint8_t *)buffer;
-        uint16_t ethertype = (uint16_t)((eth[12] << 8) | eth[13]);
-        if (ethertype == 0x0800) {
-            uint8_t proto = eth[23];
-            if (proto == 17) {
-                uint16_t src_port = (uint16_t)((eth[34] << 8) | eth[35]);
-                uint16_t dst_port = (uint16_t)((eth[36] << 8) | eth[37]);
-                if (src_port == 67 && dst_port == 68) {
-                    event_log_record(EVT_DHCP_OFFER_TX, NULL); // OFFER/ACK both look like this here
-                }
-            }
-        }
+    pkt_info_t info;
+    pkt_classify((const uint8_t *)buffer, len, &info);
+    record_dhcp_event(&info, true);
+
+    if (len > NCM_TX_FRAME_MAX) {
+        ctr_inc(NET_CTR_TX_DROP_OVERSIZE);
+        return ESP_ERR_INVALID_SIZE;
     }
 
-    // Retry a couple times; iOS DHCP bursts are tight.
-    esp_err_t ret = ESP_FAIL;
-    for (int attempt = 0; attempt < 3; attempt++) {
-        ret = tinyusb_net_send_sync(buffer, (uint16_t)len, NULL, pdMS_TO_TICKS(250));
-        if (ret == ESP_OK) break;
-        vTaskDelay(pdMS_TO_TICKS(10));
+    // Pool empty == queue full: report ERR_MEM so lwIP backs off and retries.
+    tx_frame_t *frame = frame_pool_alloc(&s_tx_pool);
+    if (!frame) {
+        ctr_inc(NET_CTR_TX_DROP_QUEUE_FULL);
+        return ESP_ERR_NO_MEM;
     }
+    frame->len = (uint16_t)len;
+    memcpy(frame->data, buffer, len);
 
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "TX FAILED: %s", esp_err_to_name(ret));
+    frame->enqueued_us = esp_timer_get_time();
+    hist_add(&s_hist_tx_size, (uint32_t)len);
+    hist_add_gap(&s_hist_tx_gap_us, &s_last_tx_us, frame->enqueued_us);
+
+    if (!spsc_ring_push(&s_tx_ring, frame)) {
+        frame_pool_free(&s_tx_pool, frame);
+        ctr_inc(NET_CTR_TX_DROP_QUEUE_FULL);
+        return ESP_ERR_NO_MEM;
     }
+    xTaskNotifyGive(s_tx_sender_task);
+
+#if CONFIG_NCM_PCAP_CAPTURE
+    // Capture from lwIP's buffer: the queued copy may already be in flight.
+    pcap_capture_frame((const uint8_t *)buffer, len, &info);
+#endif
 
     return ESP_OK;
 }
@@ -361,6 +810,59 @@ esp_err_t network_init(void)
     ESP_LOGI(TAG, "NETWORK INITIALIZATION STARTING");
     ESP_LOGI(TAG, "========================================");
 
+    // RX pool must exist before the NCM callback can fire
+    frame_pool_init(&s_rx_pool, s_rx_frames, sizeof(rx_frame_t),
+                    s_rx_free_stack, CONFIG_NCM_RX_POOL_FRAMES);
+    ESP_LOGI(TAG, "RX frame pool: %d x %u bytes",
+             CONFIG_NCM_RX_POOL_FRAMES, (unsigned)sizeof(rx_frame_t));
+
+#if CONFIG_NCM_RX_WORKER
+    // RX worker decouples lwIP input from the TinyUSB task
+    spsc_ring_init(&s_rx_ring, s_rx_ring_slots, NCM_RX_RING_SIZE);
+    if (!s_rx_worker_task) {
+        BaseType_t core = (CONFIG_NCM_RX_WORKER_CORE < 0) ? tskNO_AFFINITY : CONFIG_NCM_RX_WORKER_CORE;
+        if (xTaskCreatePinnedToCore(rx_worker_task, "ncm_rx", NCM_RX_WORKER_STACK, NULL,
+                                    CONFIG_NCM_RX_WORKER_PRIORITY, &s_rx_worker_task,
+                                    core) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create RX worker task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    ESP_LOGI(TAG, "RX worker: prio %d, core %d",
+             CONFIG_NCM_RX_WORKER_PRIORITY, CONFIG_NCM_RX_WORKER_CORE);
+#endif
+
+    // TX queue + USB sender; netif_transmit never blocks on USB
+    frame_pool_init(&s_tx_pool, s_tx_frames, sizeof(tx_frame_t),
+                    s_tx_free_stack, CONFIG_NCM_TX_QUEUE_FRAMES);
+    spsc_ring_init(&s_tx_ring, s_tx_ring_slots, NCM_TX_RING_SIZE);
+    if (!s_tx_agg_timer) {
+        const esp_timer_create_args_t agg_timer_args = {
+            .callback = tx_agg_window_end,
+            .name = "ncm_tx_agg",
+        };
+        esp_err_t err = esp_timer_create(&agg_timer_args, &s_tx_agg_timer);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create TX aggregation timer: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+    if (!s_tx_sender_task) {
+        if (xTaskCreatePinnedToCore(tx_sender_task, "ncm_tx", NCM_TX_SENDER_STACK, NULL,
+                                    CONFIG_NCM_TX_TASK_PRIORITY, &s_tx_sender_task,
+                                    tskNO_AFFINITY) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create TX sender task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    ESP_LOGI(TAG, "TX queue: %d x %u bytes",
+             CONFIG_NCM_TX_QUEUE_FRAMES, (unsigned)sizeof(tx_frame_t));
+
+#if CONFIG_NCM_PCAP_CAPTURE
+    // Capture starts off; the ring is only allocated when enabled over HTTP
+    pcap_capture_init();
+#endif
+
     // [1] TinyUSB driver
     ESP_LOGI(TAG, "[1/7] Installing TinyUSB driver...");
     const tinyusb_config_t tusb_cfg = {
@@ -426,7 +928,11 @@ esp_err_t network_init(void)
     struct esp_netif_netstack_config lwip_netif_config = {
         .lwip = {
             .init_fn = ethernetif_init,
+#if CONFIG_NCM_RX_MODE_PBUF_CUSTOM
+            .input_fn = ncm_netif_input
+#else
             .input_fn = ethernetif_input
+#endif
         }
     };
 
@@ -492,11 +998,104 @@ esp_err_t network_init(void)
     return ESP_OK;
 }
 
-void network_get_stats(uint32_t *rx_pkts, uint32_t *tx_pkts,
-                       uint32_t *rx_bytes_out, uint32_t *tx_bytes_out)
+void network_get_stats(network_stats_t *out)
 {
-    if (rx_pkts) *rx_pkts = s_rx_packets;
-    if (tx_pkts) *tx_pkts = s_tx_packets;
-    if (rx_bytes_out) *rx_bytes_out = s_rx_bytes;
-    if (tx_bytes_out) *tx_bytes_out = s_tx_bytes;
+    if (!out) return;
+
+    uint64_t v[NET_CTR_COUNT];
+    ctr_snapshot(v);
+
+    memset(out, 0, sizeof(*out));
+    out->rx_packets = v[NET_CTR_RX_PACKETS];
+    out->rx_bytes = v[NET_CTR_RX_BYTES];
+    out->rx_errors = v[NET_CTR_RX_ERRORS];
+    out->rx_drop_not_ready = v[NET_CTR_RX_DROP_NOT_READY];
+    out->rx_drop_oversize = v[NET_CTR_RX_DROP_OVERSIZE];
+    out->rx_drop_no_buffer = v[NET_CTR_RX_DROP_NO_BUFFER];
+    out->rx_drop_ring_full = v[NET_CTR_RX_DROP_RING_FULL];
+    out->rx_drops = out->rx_drop_not_ready + out->rx_drop_oversize +
+                    out->rx_drop_no_buffer + out->rx_drop_ring_full;
+    out->rx_bytes_copied = v[NET_CTR_RX_BYTES_COPIED];
+
+    out->tx_packets = v[NET_CTR_TX_PACKETS];
+    out->tx_bytes = v[NET_CTR_TX_BYTES];
+    out->tx_retries = v[NET_CTR_TX_RETRIES];
+    out->tx_drop_not_ready = v[NET_CTR_TX_DROP_NOT_READY];
+    out->tx_drop_oversize = v[NET_CTR_TX_DROP_OVERSIZE];
+    out->tx_drop_queue_full = v[NET_CTR_TX_DROP_QUEUE_FULL];
+    out->tx_drop_link_down = v[NET_CTR_TX_DROP_LINK_DOWN];
+    out->tx_drop_usb_timeout = v[NET_CTR_TX_DROP_USB_TIMEOUT];
+    out->tx_drop_usb_error = v[NET_CTR_TX_DROP_USB_ERROR];
+    out->tx_errors = out->tx_drop_usb_timeout + out->tx_drop_usb_error;
+    out->tx_drops = out->tx_drop_not_ready + out->tx_drop_oversize +
+                    out->tx_drop_queue_full + out->tx_drop_link_down + out->tx_errors;
+    out->tx_agg_flushes = v[NET_CTR_TX_AGG_FLUSHES];
+    out->tx_agg_datagrams = v[NET_CTR_TX_AGG_DATAGRAMS];
+    out->tx_agg_bypass = v[NET_CTR_TX_AGG_BYPASS];
+}
+
+void network_get_datapath_stats(network_datapath_stats_t *out)
+{
+    if (!out) return;
+
+    frame_pool_stats_t pool;
+    frame_pool_get_stats(&s_rx_pool, &pool);
+
+    uint64_t v[NET_CTR_COUNT];
+    ctr_snapshot(v);
+
+    memset(out, 0, sizeof(*out));
+    out->rx_pool_capacity = pool.capacity;
+    out->rx_pool_in_use = pool.in_use;
+    out->rx_pool_in_use_hwm = pool.in_use_hwm;
+    out->rx_pool_exhausted = pool.exhausted;
+    out->rx_copy_ratio_x1000 = v[NET_CTR_RX_BYTES] ?
+        (uint32_t)((v[NET_CTR_RX_BYTES_COPIED] * 1000) / v[NET_CTR_RX_BYTES]) : 0;
+#if CONFIG_NCM_RX_WORKER
+    out->rx_ring_depth = spsc_ring_depth(&s_rx_ring);
+    out->rx_ring_hwm = s_rx_ring.hwm;
+#endif
+
+    frame_pool_get_stats(&s_tx_pool, &pool);
+    out->tx_queue_capacity = pool.capacity;
+    out->tx_queue_depth = pool.in_use;
+    out->tx_queue_hwm = pool.in_use_hwm;
+    out->tx_agg_max_batch = s_tx_agg_max_batch;
+}
+
+static size_t hist_to_json(char *buf, size_t size, const char *name, const net_hist_t *h, bool last)
+{
+    size_t written = snprintf(buf, size, "  \"%s\": [", name);
+
+    for (int i = 0; i < NET_HIST_BUCKETS && written < size; i++) {
+        written += snprintf(buf + written, size - written, "%s%lu",
+                            i ? "," : "",
+                            (unsigned long)__atomic_load_n(&h->b[i], __ATOMIC_RELAXED));
+    }
+    if (written < size) {
+        written += snprintf(buf + written, size - written, "]%s\n", last ? "" : ",");
+    }
+    return written;
+}
+
+size_t network_get_histograms_json(char *buf, size_t size)
+{
+    if (!buf || size == 0) return 0;
+
+    size_t written = snprintf(buf, size, "{\n  \"bucket_le\": [0");
+    for (int i = 1; i < NET_HIST_BUCKETS - 1 && written < size; i++) {
+        written += snprintf(buf + written, size - written, ",%lu", (unsigned long)((1UL << i) - 1));
+    }
+    if (written < size) {
+        written += snprintf(buf + written, size - written, ",\"+Inf\"],\n");
+    }
+
+    if (written < size) written += hist_to_json(buf + written, size - written, "rx_frame_bytes", &s_hist_rx_size, false);
+    if (written < size) written += hist_to_json(buf + written, size - written, "tx_frame_bytes", &s_hist_tx_size, false);
+    if (written < size) written += hist_to_json(buf + written, size - written, "rx_gap_us", &s_hist_rx_gap_us, false);
+    if (written < size) written += hist_to_json(buf + written, size - written, "tx_gap_us", &s_hist_tx_gap_us, false);
+    if (written < size) written += hist_to_json(buf + written, size - written, "tx_latency_us", &s_hist_tx_latency_us, true);
+    if (written < size) written += snprintf(buf + written, size - written, "}\n");
+
+    return (written < size) ? written : size - 1;
 }
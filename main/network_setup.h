@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include "esp_err.h"
 
@@ -26,16 +27,86 @@ extern "C" {
  */
 esp_err_t network_init(void);
 
+/**
+ * @brief Traffic counters for the USB NCM interface
+ *
+ * All counters are 64-bit and monotonic since boot. Totals (rx_drops,
+ * tx_drops, tx_errors) are the sums of the per-reason fields below them.
+ */
+typedef struct {
+    uint64_t rx_packets;            // Frames received from the host
+    uint64_t rx_bytes;
+    uint64_t rx_drops;              // Frames discarded before reaching lwIP
+    uint64_t rx_errors;             // esp_netif_receive failures
+    uint64_t tx_packets;            // Frames delivered to TinyUSB
+    uint64_t tx_bytes;
+    uint64_t tx_drops;              // Frames not delivered, any reason
+    uint64_t tx_errors;             // USB send failures (timeout + error)
+    uint64_t tx_retries;            // USB send retries
+
+    uint64_t rx_drop_not_ready;     // netif not created yet
+    uint64_t rx_drop_oversize;      // larger than an RX buffer
+    uint64_t rx_drop_no_buffer;     // RX pool exhausted
+    uint64_t rx_drop_ring_full;     // RX worker ring full
+    uint64_t rx_bytes_copied;       // Bytes memcpy'd between the NTB and lwIP
+
+    uint64_t tx_drop_not_ready;     // USB not mounted or link down at submit
+    uint64_t tx_drop_oversize;      // larger than a TX buffer
+    uint64_t tx_drop_queue_full;    // rejected with ERR_MEM (backpressure to lwIP)
+    uint64_t tx_drop_link_down;     // link went down while queued
+    uint64_t tx_drop_usb_timeout;   // USB send timed out on every attempt
+    uint64_t tx_drop_usb_error;     // USB send failed
+    uint64_t tx_agg_flushes;        // TX batches submitted back-to-back to TinyUSB
+    uint64_t tx_agg_datagrams;      // Frames across all batches (/ flushes = datagrams per batch)
+    uint64_t tx_agg_bypass;         // Small frames sent immediately, skipping the window
+} network_stats_t;
+
 /**
  * @brief Get network statistics
  *
- * @param rx_pkts     Output: number of received packets (can be NULL)
- * @param tx_pkts     Output: number of transmitted packets (can be NULL)
- * @param rx_bytes    Output: total bytes received (can be NULL)
- * @param tx_bytes    Output: total bytes transmitted (can be NULL)
+ * Safe to call from any task; the snapshot is consistent per core and never
+ * torn, even while traffic is flowing.
+ *
+ * @param out  Output: filled with the current counters
+ */
+void network_get_stats(network_stats_t *out);
+
+/**
+ * @brief Data path gauges (buffer pools, queues)
+ */
+typedef struct {
+    uint32_t rx_pool_capacity;      // RX frame buffers available in total
+    uint32_t rx_pool_in_use;        // RX frame buffers currently held by lwIP
+    uint32_t rx_pool_in_use_hwm;    // Peak of rx_pool_in_use
+    uint32_t rx_pool_exhausted;     // Allocation attempts that found the pool empty
+    uint32_t rx_copy_ratio_x1000;   // Bytes copied per byte received, x1000 (1000 = one copy)
+    uint32_t rx_ring_depth;         // Frames waiting for the RX worker
+    uint32_t rx_ring_hwm;           // Peak of rx_ring_depth
+    uint32_t tx_queue_capacity;     // TX frames that can be queued for USB
+    uint32_t tx_queue_depth;        // TX frames currently queued or in flight
+    uint32_t tx_queue_hwm;          // Peak of tx_queue_depth
+    uint32_t tx_agg_max_batch;      // Largest TX batch seen
+} network_datapath_stats_t;
+
+/**
+ * @brief Get data path gauges
+ *
+ * @param out  Output: filled with a snapshot of the gauges
+ */
+void network_get_datapath_stats(network_datapath_stats_t *out);
+
+/**
+ * @brief Get frame-size, inter-arrival and TX latency histograms as JSON
+ *
+ * Log2 buckets: "bucket_le" lists the inclusive upper bound of each bucket.
+ * Histograms: rx_frame_bytes, tx_frame_bytes, rx_gap_us, tx_gap_us and
+ * tx_latency_us (netif_transmit until TinyUSB accepted the frame).
+ *
+ * @param buf   Output buffer
+ * @param size  Buffer size
+ * @return Number of bytes written
  */
-void network_get_stats(uint32_t *rx_pkts, uint32_t *tx_pkts,
-                       uint32_t *rx_bytes, uint32_t *tx_bytes);
+size_t network_get_histograms_json(char *buf, size_t size);
 
 #ifdef __cplusplus
 }
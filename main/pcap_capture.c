@@ -0,0 +1,307 @@
+/*
+ * Packet Capture Implementation
+ * Bounded in-memory pcap ring fed from the USB NCM RX/TX paths
+ *
+ * Design:
+ * - One byte ring holding ready-to-send pcap records, oldest evicted first
+ * - Positions are free-running 32-bit counters; a download keeps a cursor
+ *   and skips ahead if the writer laps it
+ * - Reconfiguring clears the ring and bumps a generation number; a cursor
+ *   from an older generation ends its download instead of reading records
+ *   at positions that now mean something else
+ * - A record never straddles the end of the ring: if it doesn't fit, a wrap
+ *   marker fills the tail and the record starts at offset 0
+ * - A spinlock guards the ring; every critical section copies at most one
+ *   record, so neither the data path nor a download ever waits long
+ * - When capture is off the hook is a single flag test and the ring is freed
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pcap_capture.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+
+#define PCAP_ENTRY_HDR_LEN      4       // our length word in front of each record
+#define PCAP_REC_HDR_LEN        16
+#define PCAP_WRAP_MARKER        0xFFFFFFFFu
+#define PCAP_SNAPLEN            1536
+#define PCAP_HEADERS_SNAP_NONIP 128
+#define PCAP_LINKTYPE_ETHERNET  1
+
+// Power of two, so pos % size stays continuous when positions wrap
+#define PCAP_RING_SIZE          (CONFIG_NCM_PCAP_RING_KB * 1024)
+#if (PCAP_RING_SIZE & (PCAP_RING_SIZE - 1)) != 0
+#error "CONFIG_NCM_PCAP_RING_KB must be a power of two"
+#endif
+
+typedef struct {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+} pcap_rec_hdr_t;
+
+static uint8_t *s_ring = NULL;
+static uint32_t s_ring_size = 0;
+static uint32_t s_head = 0;         // position of the next write
+static uint32_t s_tail = 0;         // position of the oldest record
+static uint32_t s_records = 0;
+static uint32_t s_generation = 0;   // Bumped whenever the ring is cleared
+
+static volatile bool s_enabled = false;
+static pcap_capture_config_t s_config;
+
+static uint32_t s_captured = 0;
+static uint32_t s_evicted = 0;
+static uint32_t s_dropped = 0;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint32_t align4(uint32_t n)
+{
+    return (n + 3) & ~3u;
+}
+
+static inline uint32_t ring_off(uint32_t pos)
+{
+    return pos % s_ring_size;
+}
+
+static inline uint32_t entry_word(uint32_t pos)
+{
+    uint32_t w;
+    memcpy(&w, s_ring + ring_off(pos), sizeof(w));
+    return w;
+}
+
+// Advance past a wrap marker, if the cursor sits on one. Lock held.
+static inline uint32_t skip_wrap(uint32_t pos)
+{
+    if (pos != s_head && entry_word(pos) == PCAP_WRAP_MARKER) {
+        pos += s_ring_size - ring_off(pos);
+    }
+    return pos;
+}
+
+// Drop the oldest record (or wrap marker). Lock held.
+static void evict_oldest(void)
+{
+    uint32_t w = entry_word(s_tail);
+    if (w == PCAP_WRAP_MARKER) {
+        s_tail += s_ring_size - ring_off(s_tail);
+    } else {
+        s_tail += w;
+        s_records--;
+        s_evicted++;
+    }
+}
+
+// Evict until n bytes are free. Lock held.
+static void ensure_free(uint32_t n)
+{
+    while (s_ring_size - (s_head - s_tail) < n) {
+        evict_oldest();
+    }
+}
+
+void pcap_capture_init(void)
+{
+    memset(&s_config, 0, sizeof(s_config));
+    s_enabled = false;
+}
+
+esp_err_t pcap_capture_configure(const pcap_capture_config_t *config)
+{
+    if (!config) return ESP_ERR_INVALID_ARG;
+
+    uint8_t *new_ring = NULL;
+    uint32_t new_size = 0;
+
+    if (config->mode != PCAP_MODE_OFF) {
+        portENTER_CRITICAL(&s_lock);
+        bool have_ring = (s_ring != NULL);
+        portEXIT_CRITICAL(&s_lock);
+
+        if (!have_ring) {
+            new_size = PCAP_RING_SIZE;
+            new_ring = malloc(new_size);
+            if (!new_ring) return ESP_ERR_NO_MEM;
+        }
+    }
+
+    uint8_t *old_ring = NULL;
+
+    portENTER_CRITICAL(&s_lock);
+    if (config->mode == PCAP_MODE_OFF) {
+        s_enabled = false;
+        old_ring = s_ring;
+        s_ring = NULL;
+        s_ring_size = 0;
+    } else if (new_ring) {
+        s_ring = new_ring;
+        s_ring_size = new_size;
+    }
+    s_config = *config;
+    s_head = 0;
+    s_tail = 0;
+    s_records = 0;
+    s_generation++;
+    s_captured = 0;
+    s_evicted = 0;
+    s_dropped = 0;
+    s_enabled = (s_ring != NULL);
+    portEXIT_CRITICAL(&s_lock);
+
+    free(old_ring);
+    return ESP_OK;
+}
+
+void pcap_capture_frame(const uint8_t *frame, size_t len, const pkt_info_t *info)
+{
+    if (!s_enabled) return;
+
+    int64_t now = esp_timer_get_time();
+
+    // Filter with the config the ring was cleared for, not one being changed
+    portENTER_CRITICAL(&s_lock);
+    pcap_capture_config_t cfg = s_config;
+    uint32_t generation = s_generation;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (cfg.mode == PCAP_MODE_OFF) return;
+    if (cfg.ethertype && info->ethertype != cfg.ethertype) return;
+    if (cfg.port && info->src_port != cfg.port && info->dst_port != cfg.port) return;
+
+    uint32_t caplen = (uint32_t)len;
+    if (cfg.mode == PCAP_MODE_HEADERS) {
+        uint32_t snap = info->payload_off ? info->payload_off : PCAP_HEADERS_SNAP_NONIP;
+        if (caplen > snap) caplen = snap;
+    }
+    if (caplen > PCAP_SNAPLEN) caplen = PCAP_SNAPLEN;
+
+    pcap_rec_hdr_t rec = {
+        .ts_sec = (uint32_t)(now / 1000000),
+        .ts_usec = (uint32_t)(now % 1000000),
+        .incl_len = caplen,
+        .orig_len = (uint32_t)len,
+    };
+    uint32_t need = align4(PCAP_ENTRY_HDR_LEN + PCAP_REC_HDR_LEN + caplen);
+
+    portENTER_CRITICAL(&s_lock);
+    if (!s_ring || need > s_ring_size / 2 || generation != s_generation) {
+        s_dropped++;
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+
+    // Records are contiguous: pad the rest of the ring with a wrap marker.
+    uint32_t contiguous = s_ring_size - ring_off(s_head);
+    if (need > contiguous) {
+        ensure_free(contiguous);
+        uint32_t marker = PCAP_WRAP_MARKER;
+        memcpy(s_ring + ring_off(s_head), &marker, sizeof(marker));
+        s_head += contiguous;
+    }
+    ensure_free(need);
+
+    uint8_t *p = s_ring + ring_off(s_head);
+    memcpy(p, &need, PCAP_ENTRY_HDR_LEN);
+    memcpy(p + PCAP_ENTRY_HDR_LEN, &rec, PCAP_REC_HDR_LEN);
+    memcpy(p + PCAP_ENTRY_HDR_LEN + PCAP_REC_HDR_LEN, frame, caplen);
+    s_head += need;
+    s_records++;
+    s_captured++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void pcap_capture_get_status(pcap_capture_status_t *out)
+{
+    if (!out) return;
+
+    portENTER_CRITICAL(&s_lock);
+    out->config = s_config;
+    out->ring_size = s_ring_size;
+    out->bytes_used = s_head - s_tail;
+    out->records = s_records;
+    out->captured = s_captured;
+    out->evicted = s_evicted;
+    out->dropped = s_dropped;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+size_t pcap_capture_global_header(uint8_t *buf)
+{
+    // Native byte order (little-endian); readers detect it from the magic.
+    const uint32_t magic = 0xA1B2C3D4;
+    const uint16_t ver_major = 2;
+    const uint16_t ver_minor = 4;
+    const int32_t thiszone = 0;
+    const uint32_t sigfigs = 0;
+    const uint32_t snaplen = PCAP_SNAPLEN;
+    const uint32_t linktype = PCAP_LINKTYPE_ETHERNET;
+
+    memcpy(buf + 0, &magic, 4);
+    memcpy(buf + 4, &ver_major, 2);
+    memcpy(buf + 6, &ver_minor, 2);
+    memcpy(buf + 8, &thiszone, 4);
+    memcpy(buf + 12, &sigfigs, 4);
+    memcpy(buf + 16, &snaplen, 4);
+    memcpy(buf + 20, &linktype, 4);
+    return PCAP_GLOBAL_HDR_LEN;
+}
+
+void pcap_capture_cursor_init(pcap_cursor_t *cur)
+{
+    if (!cur) return;
+
+    portENTER_CRITICAL(&s_lock);
+    cur->pos = s_tail;
+    cur->end = s_head;
+    cur->generation = s_generation;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+size_t pcap_capture_read(pcap_cursor_t *cur, uint8_t *buf, size_t size)
+{
+    if (!cur || !buf) return 0;
+
+    size_t copied = 0;
+
+    // One record per critical section keeps the data path's wait short.
+    while (1) {
+        portENTER_CRITICAL(&s_lock);
+        if (!s_ring || cur->generation != s_generation) {
+            portEXIT_CRITICAL(&s_lock);
+            break;              // Off, or cleared: these positions are gone
+        }
+
+        if ((int32_t)(cur->pos - s_tail) < 0) {
+            cur->pos = s_tail;          // lapped: resume at the oldest record
+        }
+        cur->pos = skip_wrap(cur->pos);
+
+        if ((int32_t)(cur->end - cur->pos) <= 0 || (int32_t)(s_head - cur->pos) <= 0) {
+            portEXIT_CRITICAL(&s_lock);
+            break;
+        }
+
+        const uint8_t *p = s_ring + ring_off(cur->pos);
+        uint32_t entry_len = entry_word(cur->pos);
+        pcap_rec_hdr_t rec;
+        memcpy(&rec, p + PCAP_ENTRY_HDR_LEN, PCAP_REC_HDR_LEN);
+        size_t rec_len = PCAP_REC_HDR_LEN + rec.incl_len;
+
+        if (copied + rec_len > size) {
+            portEXIT_CRITICAL(&s_lock);
+            break;
+        }
+
+        memcpy(buf + copied, p + PCAP_ENTRY_HDR_LEN, rec_len);
+        copied += rec_len;
+        cur->pos += entry_len;
+        portEXIT_CRITICAL(&s_lock);
+    }
+
+    return copied;
+}
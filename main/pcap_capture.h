@@ -0,0 +1,121 @@
+/*
+ * Packet Capture Header
+ * Bounded in-memory pcap ring fed from the USB NCM RX/TX paths
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "pkt_classify.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PCAP_GLOBAL_HDR_LEN   24
+
+typedef enum {
+    PCAP_MODE_OFF = 0,
+    PCAP_MODE_HEADERS,      // Up to the end of the L4 header (or 128 bytes for non-IP)
+    PCAP_MODE_FULL,         // Whole frame
+} pcap_mode_t;
+
+/**
+ * @brief Capture configuration; 0 in a filter field matches anything
+ */
+typedef struct {
+    pcap_mode_t mode;
+    uint16_t ethertype;     // e.g. 0x0800, 0x0806, 0x86DD
+    uint16_t port;          // TCP/UDP source or destination port
+} pcap_capture_config_t;
+
+typedef struct {
+    pcap_capture_config_t config;
+    uint32_t ring_size;     // Bytes reserved for the ring (0 while off)
+    uint32_t bytes_used;
+    uint32_t records;       // Frames currently held
+    uint32_t captured;      // Frames written since capture was enabled
+    uint32_t evicted;       // Oldest frames overwritten to make room
+    uint32_t dropped;       // Frames skipped (ring being torn down, record too large)
+} pcap_capture_status_t;
+
+/**
+ * @brief Initialize capture state (capture starts disabled)
+ */
+void pcap_capture_init(void);
+
+/**
+ * @brief Enable, reconfigure or disable capture
+ *
+ * Enabling allocates the ring once (CONFIG_NCM_PCAP_RING_KB); switching to
+ * PCAP_MODE_OFF releases it. Changing the filter clears the ring and ends
+ * downloads in progress (see pcap_capture_read()).
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if the ring could not be allocated
+ */
+esp_err_t pcap_capture_configure(const pcap_capture_config_t *config);
+
+/**
+ * @brief Offer a frame to the capture ring
+ *
+ * Returns immediately when capture is off. Never blocks: the ring lock is
+ * only ever held for the copy of a single record.
+ *
+ * @param frame  Ethernet frame
+ * @param len    Frame length
+ * @param info   Classification of the frame (for the filter and snap length)
+ */
+void pcap_capture_frame(const uint8_t *frame, size_t len, const pkt_info_t *info);
+
+/**
+ * @brief Get capture configuration and counters
+ */
+void pcap_capture_get_status(pcap_capture_status_t *out);
+
+/**
+ * @brief Write the pcap global header (LINKTYPE_ETHERNET)
+ *
+ * @param buf  Output buffer of at least PCAP_GLOBAL_HDR_LEN bytes
+ * @return Number of bytes written
+ */
+size_t pcap_capture_global_header(uint8_t *buf);
+
+/**
+ * @brief Position for downloading the ring in pieces
+ *
+ * Set up with pcap_capture_cursor_init(); fields are read-only for callers.
+ */
+typedef struct {
+    uint32_t pos;           // Next record position
+    uint32_t end;           // Head when the cursor was set up; the download stops there
+    uint32_t generation;    // Ring contents the positions refer to
+} pcap_cursor_t;
+
+/**
+ * @brief Start a download of what is captured now
+ *
+ * The cursor starts at the oldest record and ends at the current head, so
+ * frames captured while it streams are not chased forever.
+ */
+void pcap_capture_cursor_init(pcap_cursor_t *cur);
+
+/**
+ * @brief Copy whole pcap records (record header + data) out of the ring
+ *
+ * If the writer lapped the cursor it skips ahead to the oldest record. If
+ * capture was reconfigured (which clears the ring) since the cursor was set
+ * up, the download ends.
+ *
+ * @param cur     Cursor from pcap_capture_cursor_init()
+ * @param buf     Output buffer; must hold at least one full record (2 KB)
+ * @param size    Buffer size
+ * @return Bytes copied, 0 when the download is complete or capture is off
+ */
+size_t pcap_capture_read(pcap_cursor_t *cur, uint8_t *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,291 @@
+/*
+ * Packet Classifier Implementation
+ * Single-pass, bounds-checked Ethernet frame classification
+ *
+ * Design:
+ * - One lookup table per layer (ethertype, IP protocol, UDP port), each
+ *   entry pointing at the parser for the next layer
+ * - Every header access is checked against the frame length first; a short
+ *   frame stops classification at the last complete layer
+ * - IPv4 honours IHL, so packets with options are parsed correctly
+ */
+
+#include <string.h>
+#include "pkt_classify.h"
+
+#define ETH_HDR_LEN         14
+#define VLAN_TAG_LEN        4
+#define IPV4_MIN_HDR_LEN    20
+#define IPV6_HDR_LEN        40
+#define UDP_HDR_LEN         8
+#define TCP_MIN_HDR_LEN     20
+#define BOOTP_FIXED_LEN     236     // op .. file, before the magic cookie
+#define BOOTP_YIADDR_OFF    16
+#define DHCP_OPT_PAD        0
+#define DHCP_OPT_MSG_TYPE   53
+#define DHCP_OPT_END        255
+
+typedef void (*pkt_parser_t)(const uint8_t *f, size_t len, size_t off, pkt_info_t *info);
+
+static inline uint16_t rd16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// ----------------------------
+// Application layer (UDP payload)
+// ----------------------------
+static void parse_dhcp(const uint8_t *f, size_t len, size_t off, pkt_info_t *info)
+{
+    static const uint8_t MAGIC[4] = {99, 130, 83, 99};
+
+    if (len < off + BOOTP_FIXED_LEN + sizeof(MAGIC)) {
+        info->flags |= PKT_F_TRUNCATED;
+        return;
+    }
+
+    memcpy(info->dhcp_yiaddr, f + off + BOOTP_YIADDR_OFF, 4);
+
+    size_t p = off + BOOTP_FIXED_LEN;
+    if (memcmp(f + p, MAGIC, sizeof(MAGIC)) != 0) {
+        return;     // Plain BOOTP
+    }
+    p += sizeof(MAGIC);
+
+    // Walk TLV options until message type or end
+    while (p < len) {
+        uint8_t code = f[p];
+        if (code == DHCP_OPT_END) break;
+        if (code == DHCP_OPT_PAD) {
+            p++;
+            continue;
+        }
+        if (p + 2 > len || p + 2 + f[p + 1] > len) {
+            info->flags |= PKT_F_TRUNCATED;
+            break;
+        }
+        if (code == DHCP_OPT_MSG_TYPE && f[p + 1] == 1) {
+            info->dhcp_msg = f[p + 2];
+            break;
+        }
+        p += 2 + f[p + 1];
+    }
+    if (p >= len) {
+        info->flags |= PKT_F_TRUNCATED;     // Ran out before the end option
+    }
+}
+
+static const struct {
+    uint16_t port;
+    uint8_t app;
+    pkt_parser_t parse;
+} UDP_APPS[] = {
+    { 67,   PKT_APP_DHCP, parse_dhcp },
+    { 68,   PKT_APP_DHCP, parse_dhcp },
+    { 5353, PKT_APP_MDNS, NULL },
+};
+
+// ----------------------------
+// Transport layer
+// ----------------------------
+static void parse_udp(const uint8_t *f, size_t len, size_t off, pkt_info_t *info)
+{
+    if (len < off + UDP_HDR_LEN) {
+        info->flags |= PKT_F_TRUNCATED;
+        return;
+    }
+
+    info->src_port = rd16(f + off);
+    info->dst_port = rd16(f + off + 2);
+    info->payload_off = (uint16_t)(off + UDP_HDR_LEN);
+    info->payload_len = (uint16_t)(len - info->payload_off);
+
+    for (size_t i = 0; i < sizeof(UDP_APPS) / sizeof(UDP_APPS[0]); i++) {
+        if (UDP_APPS[i].port == info->dst_port || UDP_APPS[i].port == info->src_port) {
+            info->app = UDP_APPS[i].app;
+            if (UDP_APPS[i].parse) {
+                UDP_APPS[i].parse(f, len, info->payload_off, info);
+            }
+            return;
+        }
+    }
+}
+
+static void parse_tcp(const uint8_t *f, size_t len, size_t off, pkt_info_t *info)
+{
+    if (len < off + TCP_MIN_HDR_LEN) {
+        info->flags |= PKT_F_TRUNCATED;
+        return;
+    }
+
+    size_t hdr_len = (size_t)(f[off + 12] >> 4) * 4;
+    if (hdr_len < TCP_MIN_HDR_LEN) {
+        info->flags |= PKT_F_MALFORMED;
+        return;
+    }
+    if (len < off + hdr_len) {
+        info->flags |= PKT_F_TRUNCATED;
+        return;
+    }
+
+    info->src_port = rd16(f + off);
+    info->dst_port = rd16(f + off + 2);
+    info->payload_off = (uint16_t)(off + hdr_len);
+    info->payload_len = (uint16_t)(len - info->payload_off);
+
+    uint8_t tcp_flags = f[off + 13];
+    if (tcp_flags & 0x02) info->flags |= PKT_F_TCP_SYN;
+    if (tcp_flags & 0x01) info->flags |= PKT_F_TCP_FIN;
+    if (tcp_flags & 0x04) info->flags |= PKT_F_TCP_RST;
+    if (tcp_flags == 0x10 && info->payload_len == 0) {
+        info->flags |= PKT_F_TCP_PURE_ACK;
+    }
+}
+
+static const struct {
+    uint8_t proto;
+    uint8_t l4;
+    pkt_parser_t parse;
+} IP_PROTOS[] = {
+    { 6,  PKT_L4_TCP,    parse_tcp },
+    { 17, PKT_L4_UDP,    parse_udp },
+    { 1,  PKT_L4_ICMP,   NULL },
+    { 58, PKT_L4_ICMPV6, NULL },
+};
+
+static void dispatch_ip_proto(uint8_t proto, const uint8_t *f, size_t len, size_t off,
+                              pkt_info_t *info)
+{
+    info->l4_off = (uint16_t)off;
+    info->l4 = PKT_L4_OTHER;
+
+    for (size_t i = 0; i < sizeof(IP_PROTOS) / sizeof(IP_PROTOS[0]); i++) {
+        if (IP_PROTOS[i].proto == proto) {
+            info->l4 = IP_PROTOS[i].l4;
+            if (IP_PROTOS[i].parse) {
+                IP_PROTOS[i].parse(f, len, off, info);
+            }
+            return;
+        }
+    }
+}
+
+// ----------------------------
+// Network layer
+// ----------------------------
+static void parse_ipv4(const uint8_t *f, size_t len, size_t off, pkt_info_t *info)
+{
+    if (len < off + IPV4_MIN_HDR_LEN) {
+        info->flags |= PKT_F_TRUNCATED;
+        return;
+    }
+
+    size_t ihl = (size_t)(f[off] & 0x0F) * 4;
+    if ((f[off] >> 4) != 4 || ihl < IPV4_MIN_HDR_LEN) {
+        info->flags |= PKT_F_MALFORMED;
+        return;
+    }
+    if (len < off + ihl) {
+        info->flags |= PKT_F_TRUNCATED;
+        return;
+    }
+    if (ihl > IPV4_MIN_HDR_LEN) {
+        info->flags |= PKT_F_IP_OPTIONS;
+    }
+
+    // Trust total length only to shrink the view (drops Ethernet padding)
+    size_t total = rd16(f + off + 2);
+    if (total < ihl) {
+        info->flags |= PKT_F_MALFORMED;
+    } else if (off + total < len) {
+        len = off + total;
+    } else if (off + total > len) {
+        info->flags |= PKT_F_TRUNCATED;
+    }
+
+    if (rd16(f + off + 6) & 0x1FFF) {
+        info->flags |= PKT_F_FRAGMENT;
+        return;
+    }
+
+    dispatch_ip_proto(f[off + 9], f, len, off + ihl, info);
+}
+
+static void parse_ipv6(const uint8_t *f, size_t len, size_t off, pkt_info_t *info)
+{
+    if (len < off + IPV6_HDR_LEN) {
+        info->flags |= PKT_F_TRUNCATED;
+        return;
+    }
+    if ((f[off] >> 4) != 6) {
+        info->flags |= PKT_F_MALFORMED;
+        return;
+    }
+
+    size_t payload = rd16(f + off + 4);
+    if (off + IPV6_HDR_LEN + payload < len) {
+        len = off + IPV6_HDR_LEN + payload;
+    } else if (off + IPV6_HDR_LEN + payload > len) {
+        info->flags |= PKT_F_TRUNCATED;
+    }
+
+    // Extension headers are not walked; they classify as PKT_L4_OTHER.
+    dispatch_ip_proto(f[off + 6], f, len, off + IPV6_HDR_LEN, info);
+}
+
+static const struct {
+    uint16_t ethertype;
+    uint8_t l3;
+    pkt_parser_t parse;
+} ETHERTYPES[] = {
+    { 0x0800, PKT_L3_IPV4, parse_ipv4 },
+    { 0x86DD, PKT_L3_IPV6, parse_ipv6 },
+    { 0x0806, PKT_L3_ARP,  NULL },
+};
+
+// ----------------------------
+// Public API
+// ----------------------------
+void pkt_classify(const uint8_t *frame, size_t len, pkt_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+
+    if (!frame || len < ETH_HDR_LEN) {
+        info->flags |= PKT_F_TRUNCATED;
+        return;
+    }
+
+    size_t off = 12;
+    uint16_t ethertype = rd16(frame + off);
+    if (ethertype == 0x8100) {
+        if (len < ETH_HDR_LEN + VLAN_TAG_LEN) {
+            info->flags |= PKT_F_TRUNCATED;
+            return;
+        }
+        info->flags |= PKT_F_VLAN;
+        off += VLAN_TAG_LEN;
+        ethertype = rd16(frame + off);
+    }
+    off += 2;
+
+    info->ethertype = ethertype;
+    info->l3_off = (uint16_t)off;
+
+    for (size_t i = 0; i < sizeof(ETHERTYPES) / sizeof(ETHERTYPES[0]); i++) {
+        if (ETHERTYPES[i].ethertype == ethertype) {
+            info->l3 = ETHERTYPES[i].l3;
+            if (ETHERTYPES[i].parse) {
+                ETHERTYPES[i].parse(frame, len, off, info);
+            }
+            return;
+        }
+    }
+}
+
+const char *pkt_dhcp_msg_name(uint8_t msg)
+{
+    static const char *NAMES[] = {
+        "NONE", "DISCOVER", "OFFER", "REQUEST", "DECLINE", "ACK", "NAK", "RELEASE", "INFORM",
+    };
+    return (msg < sizeof(NAMES) / sizeof(NAMES[0])) ? NAMES[msg] : "?";
+}
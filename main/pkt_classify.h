@@ -0,0 +1,102 @@
+/*
+ * Packet Classifier Header
+ * Single-pass, bounds-checked Ethernet frame classification
+ *
+ * Used once per frame on both the NCM RX and TX paths (event log, capture
+ * filter). Pure C with no ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PKT_L3_OTHER = 0,
+    PKT_L3_ARP,
+    PKT_L3_IPV4,
+    PKT_L3_IPV6,
+} pkt_l3_t;
+
+typedef enum {
+    PKT_L4_NONE = 0,        // No L3 payload parsed (non-IP, truncated, fragment)
+    PKT_L4_OTHER,
+    PKT_L4_ICMP,
+    PKT_L4_ICMPV6,
+    PKT_L4_TCP,
+    PKT_L4_UDP,
+} pkt_l4_t;
+
+typedef enum {
+    PKT_APP_NONE = 0,
+    PKT_APP_DHCP,
+    PKT_APP_MDNS,
+} pkt_app_t;
+
+// DHCP message types (RFC 2132 option 53)
+typedef enum {
+    PKT_DHCP_NONE = 0,
+    PKT_DHCP_DISCOVER = 1,
+    PKT_DHCP_OFFER = 2,
+    PKT_DHCP_REQUEST = 3,
+    PKT_DHCP_DECLINE = 4,
+    PKT_DHCP_ACK = 5,
+    PKT_DHCP_NAK = 6,
+    PKT_DHCP_RELEASE = 7,
+    PKT_DHCP_INFORM = 8,
+} pkt_dhcp_msg_t;
+
+#define PKT_F_TRUNCATED     (1u << 0)   // A header claimed more bytes than the frame holds
+#define PKT_F_VLAN          (1u << 1)   // 802.1Q tag present (skipped)
+#define PKT_F_IP_OPTIONS    (1u << 2)   // IPv4 IHL > 5
+#define PKT_F_FRAGMENT      (1u << 3)   // Non-first IPv4 fragment (no L4 header)
+#define PKT_F_TCP_SYN       (1u << 4)
+#define PKT_F_TCP_FIN       (1u << 5)
+#define PKT_F_TCP_RST       (1u << 6)
+#define PKT_F_TCP_PURE_ACK  (1u << 7)   // ACK with no payload and no other flags
+#define PKT_F_MALFORMED     (1u << 8)   // A header field is invalid (IP version, IHL, TCP offset)
+
+/**
+ * @brief Classification result; offsets are from the start of the frame
+ */
+typedef struct {
+    uint16_t ethertype;
+    uint8_t l3;             // pkt_l3_t
+    uint8_t l4;             // pkt_l4_t
+    uint8_t app;            // pkt_app_t
+    uint8_t dhcp_msg;       // pkt_dhcp_msg_t (PKT_APP_DHCP only)
+    uint16_t flags;         // PKT_F_*
+    uint16_t l3_off;
+    uint16_t l4_off;
+    uint16_t payload_off;   // First byte after the L4 header
+    uint16_t payload_len;
+    uint16_t src_port;      // TCP/UDP only
+    uint16_t dst_port;
+    uint8_t dhcp_yiaddr[4]; // "your" address from BOOTP (OFFER/ACK)
+} pkt_info_t;
+
+/**
+ * @brief Classify an Ethernet frame in one pass
+ *
+ * Never reads past frame[len - 1]. Fields that could not be parsed are left
+ * zero; PKT_F_TRUNCATED is set when a header was cut short, and
+ * PKT_F_MALFORMED when one is complete but invalid.
+ *
+ * @param frame  Ethernet frame (destination MAC first)
+ * @param len    Frame length in bytes
+ * @param info   Output: classification result
+ */
+void pkt_classify(const uint8_t *frame, size_t len, pkt_info_t *info);
+
+/**
+ * @brief Name of a DHCP message type ("DISCOVER", ...), or "?" if unknown
+ */
+const char *pkt_dhcp_msg_name(uint8_t msg);
+
+#ifdef __cplusplus
+}
+#endif
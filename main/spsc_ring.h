@@ -0,0 +1,110 @@
+/*
+ * SPSC Ring Header
+ * Lock-free single-producer/single-consumer ring of pointers
+ *
+ * Exactly one task may push and exactly one task may pop. Head is only
+ * written by the producer and tail only by the consumer, so the fast path
+ * is a pair of acquire/release accesses with no locks or critical sections.
+ * Depth statistics are maintained on the producer side.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    void **slots;
+    uint32_t mask;          // capacity - 1 (capacity is a power of two)
+    uint32_t head;          // next slot to write (producer-owned)
+    uint32_t tail;          // next slot to read (consumer-owned)
+    uint32_t hwm;           // peak depth observed by the producer
+    uint32_t drops;         // pushes rejected because the ring was full
+} spsc_ring_t;
+
+/**
+ * @brief Initialize a ring over caller-provided slot storage
+ *
+ * @param ring      Ring to initialize
+ * @param slots     Array of capacity pointers
+ * @param capacity  Number of slots, must be a power of two
+ */
+static inline void spsc_ring_init(spsc_ring_t *ring, void **slots, uint32_t capacity)
+{
+    ring->slots = slots;
+    ring->mask = capacity - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->hwm = 0;
+    ring->drops = 0;
+}
+
+/**
+ * @brief Enqueue an item (producer only)
+ * @return false if the ring is full (the item is not queued)
+ */
+static inline bool spsc_ring_push(spsc_ring_t *ring, void *item)
+{
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t depth = head - tail;
+
+    if (depth > ring->mask) {
+        ring->drops++;
+        return false;
+    }
+
+    ring->slots[head & ring->mask] = item;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    if (depth + 1 > ring->hwm) {
+        ring->hwm = depth + 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Dequeue an item (consumer only)
+ * @return Oldest item, or NULL if the ring is empty
+ */
+static inline void *spsc_ring_pop(spsc_ring_t *ring)
+{
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return NULL;
+    }
+
+    void *item = ring->slots[tail & ring->mask];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return item;
+}
+
+/**
+ * @brief Peek at the oldest item without removing it (consumer only)
+ */
+static inline void *spsc_ring_peek(spsc_ring_t *ring)
+{
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    return (head == tail) ? NULL : ring->slots[tail & ring->mask];
+}
+
+/**
+ * @brief Current number of queued items (approximate from other tasks)
+ */
+static inline uint32_t spsc_ring_depth(const spsc_ring_t *ring)
+{
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,30 @@
+/*
+ * Static Web Assets Header
+ * Pages under main/www, gzip-compressed at build time (www/embed_assets.py)
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *uri;            // Served at this path
+    const char *type;           // Content-Type
+    const char *etag;           // Quoted, derived from the compressed bytes
+    const uint8_t *gz;          // gzip body, sent as-is
+    size_t gz_len;
+    size_t raw_len;             // Uncompressed size, for the logs
+} static_asset_t;
+
+// Generated table, one entry per file under main/www
+extern const static_asset_t static_assets[];
+extern const size_t static_assets_count;
+
+#ifdef __cplusplus
+}
+#endif
@@ -30,29 +30,42 @@
 #include "esp_event.h"
 #include "esp_system.h"
 #include "esp_chip_info.h"
-#include "tusb_cdc_acm.h"
-#include "tinyusb.h"
 
 #include "network_setup.h"
 #include "http_server.h"
 #include "log_stream.h"
+#include "cdc_log.h"
 #include "wifi_setup.h"
 #include "event_log.h"
 
 static const char *TAG = "main";
 
 /**
- * @brief Custom vprintf for ESP_LOG that outputs to USB CDC-ACM
+ * @brief Custom vprintf for ESP_LOG that feeds the log ring
  *
- * This function intercepts all ESP_LOG output and sends it over
- * the USB CDC-ACM virtual serial port. This allows monitoring
- * logs via `screen /dev/cu.usbmodem* 115200` on macOS.
+ * This function intercepts all ESP_LOG output. It only appends the line to
+ * the log ring; the CDC drain task (cdc_log.c) sends it to the USB CDC-ACM
+ * virtual serial port, so logging from the lwIP or TinyUSB task never waits
+ * on USB. Monitor via `screen /dev/cu.usbmodem* 115200` on macOS.
  *
  * Note: If no terminal is connected (tud_cdc_connected() == false),
- * logs are silently dropped to avoid blocking.
+ * lines only go to the ring (SSE and /logs_all).
+ *
+ * With CONFIG_LOG_DEFERRED_FORMAT the line is stored packed (format
+ * pointer + arguments) and only formatted when a reader consumes it.
  */
 static int cdc_log_vprintf(const char *fmt, va_list args)
 {
+#if CONFIG_LOG_DEFERRED_FORMAT
+    va_list copy;
+    va_copy(copy, args);
+    bool packed = log_buffer_add_packed(fmt, copy);
+    va_end(copy);
+    if (packed) {
+        return 0;
+    }
+#endif
+
     char buf[512];  // Increased buffer for longer log lines
     int len = vsnprintf(buf, sizeof(buf), fmt, args);
 
@@ -63,14 +76,8 @@ static int cdc_log_vprintf(const char *fmt, va_list args)
             buf[len-1] = '\n';  // Ensure newline
         }
 
-        // Add to log buffer for SSE streaming
+        // Add to log buffer for SSE streaming and the CDC drain
         log_buffer_add(buf, len);
-
-        // Only send to USB CDC if connected (terminal open)
-        if (tud_cdc_connected()) {
-            tinyusb_cdcacm_write_queue(TINYUSB_CDC_ACM_0, (uint8_t *)buf, len);
-            tinyusb_cdcacm_write_flush(TINYUSB_CDC_ACM_0, 0);
-        }
     }
     return len;
 }
@@ -174,6 +181,9 @@ void app_main(void)
     // instead of the default UART. Connect a terminal to see logs.
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "[BOOT 6/7] Redirecting logs to USB CDC-ACM...");
+    if (cdc_log_start() != ESP_OK) {
+        ESP_LOGW(TAG, "           CDC log drain failed to start (logs still go to /logs)");
+    }
     esp_log_set_vprintf(cdc_log_vprintf);
     ESP_LOGI(TAG, "           Logs now output to /dev/cu.usbmodem* (macOS)");
     ESP_LOGI(TAG, "           Use: screen /dev/cu.usbmodem* 115200");
@@ -202,11 +212,14 @@ void app_main(void)
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "Available endpoints:");
     ESP_LOGI(TAG, "  GET  /          - Status page");
+    ESP_LOGI(TAG, "  GET  /dashboard - LED, events, log ring stats, live logs");
     ESP_LOGI(TAG, "  GET  /led       - LED state (JSON)");
     ESP_LOGI(TAG, "  POST /led/on    - Turn LED on");
     ESP_LOGI(TAG, "  POST /led/off   - Turn LED off");
     ESP_LOGI(TAG, "  POST /reset     - Restart ESP32");
     ESP_LOGI(TAG, "  GET  /logs      - SSE log stream (real-time)");
+    ESP_LOGI(TAG, "  GET  /access    - HTTP access log (JSON)");
+    ESP_LOGI(TAG, "  GET  /metrics   - Prometheus metrics");
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "Serial monitor (USB CDC):");
     ESP_LOGI(TAG, "  macOS: screen /dev/cu.usbmodem* 115200");
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""
+Compress the web pages and emit them as a C table for static_assets.h.
+
+    embed_assets.py <output.c> <file>...
+
+index.html is served at "/", any other page at "/<name without .html>".
+gzip output is made reproducible (no name or timestamp), so the ETag only
+changes when a page does.
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+
+TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".svg": "image/svg+xml",
+}
+
+
+def uri_for(path):
+    name = os.path.basename(path)
+    if name == "index.html":
+        return "/"
+    stem, ext = os.path.splitext(name)
+    return "/" + (stem if ext == ".html" else name)
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + " ".join(f"0x{b:02x}," for b in data[i:i + 16]))
+    return "\n".join(lines)
+
+
+def main():
+    out_path, files = sys.argv[1], sys.argv[2:]
+    parts = ["// Generated by main/www/embed_assets.py - do not edit\n",
+             '#include "static_assets.h"\n']
+    entries = []
+
+    for n, path in enumerate(files):
+        with open(path, "rb") as f:
+            raw = f.read()
+        gz = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = hashlib.sha1(gz).hexdigest()[:16]
+        ext = os.path.splitext(path)[1]
+        parts.append(f"// {os.path.basename(path)}: {len(raw)} -> {len(gz)} bytes\n"
+                     f"static const uint8_t s_asset_{n}[] = {{\n{c_bytes(gz)}\n}};\n")
+        ctype = TYPES.get(ext, "application/octet-stream")
+        entries.append(f'    {{ "{uri_for(path)}", "{ctype}", "\\"{etag}\\"", '
+                       f"s_asset_{n}, sizeof(s_asset_{n}), {len(raw)} }},")
+
+    parts.append("const static_asset_t static_assets[] = {\n" + "\n".join(entries) + "\n};\n")
+    parts.append("const size_t static_assets_count = sizeof(static_assets) / sizeof(static_assets[0]);\n")
+
+    text = "\n".join(parts)
+    # Leave an unchanged file alone so it isn't recompiled
+    if os.path.exists(out_path):
+        with open(out_path) as f:
+            if f.read() == text:
+                return
+    with open(out_path, "w") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()
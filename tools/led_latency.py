@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""
+/led latency with and without open /logs streams.
+
+    python3 tools/led_latency.py [host] [count] [streams]
+
+Times GET /led and POST /led/on over a fresh HTTP connection each, first
+with no streams open, then again with `streams` (default 4) /logs clients
+attached and draining in the background. Log streams are served by the
+broadcaster task, so the two runs should be close; a large gap means a
+stream is holding up the httpd task. Standard library only.
+"""
+
+import socket
+import statistics
+import sys
+import threading
+import time
+
+HOST = sys.argv[1] if len(sys.argv) > 1 else "192.168.7.1"
+COUNT = int(sys.argv[2]) if len(sys.argv) > 2 else 100
+STREAMS = int(sys.argv[3]) if len(sys.argv) > 3 else 4
+
+
+def http(method, path):
+    with socket.create_connection((HOST, 80)) as s:
+        s.sendall(f"{method} {path} HTTP/1.1\r\nHost: {HOST}\r\n"
+                  "Content-Length: 0\r\nConnection: close\r\n\r\n".encode())
+        while s.recv(4096):
+            pass
+
+
+def open_stream():
+    s = socket.create_connection((HOST, 80))
+    s.sendall(f"GET /logs HTTP/1.1\r\nHost: {HOST}\r\n"
+              "Accept: text/event-stream\r\n\r\n".encode())
+    resp = b""
+    while b"\r\n\r\n" not in resp:
+        chunk = s.recv(1024)
+        if not chunk:
+            raise SystemExit("/logs closed during handshake")
+        resp += chunk
+    if b" 200 " not in resp.split(b"\r\n", 1)[0]:
+        raise SystemExit("/logs refused: " + resp.decode(errors="replace"))
+    return s
+
+
+def drain(s, counter, idx):
+    try:
+        while True:
+            chunk = s.recv(4096)
+            if not chunk:
+                break
+            counter[idx] += len(chunk)
+    except OSError:
+        pass
+
+
+def bench(name, fn):
+    samples = []
+    for i in range(COUNT):
+        t = time.perf_counter()
+        fn(i)
+        samples.append((time.perf_counter() - t) * 1000)
+    samples.sort()
+    med = statistics.median(samples)
+    print(f"{name:30s} median {med:6.2f} ms  "
+          f"p95 {samples[int(len(samples) * 0.95) - 1]:6.2f} ms")
+    return med
+
+
+def run(label):
+    return (bench(f"GET /led      {label}", lambda i: http("GET", "/led")),
+            bench(f"POST /led/on  {label}", lambda i: http("POST", "/led/on")))
+
+
+def main():
+    base = run("(no streams)")
+
+    socks = [open_stream() for _ in range(STREAMS)]
+    received = [0] * STREAMS
+    for i, s in enumerate(socks):
+        threading.Thread(target=drain, args=(s, received, i), daemon=True).start()
+    time.sleep(0.5)
+
+    loaded = run(f"({STREAMS} streams)")
+
+    for s in socks:
+        s.close()
+
+    print(f"streamed {sum(received)} bytes over {STREAMS} /logs clients")
+    for name, b, l in zip(("GET /led", "POST /led/on"), base, loaded):
+        print(f"{name:13s} median {l - b:+6.2f} ms with streams ({l / b:4.2f}x)")
+
+
+if __name__ == "__main__":
+    main()
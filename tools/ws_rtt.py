@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""
+Round-trip latency: /ws binary commands vs the plain HTTP endpoints.
+
+    python3 tools/ws_rtt.py [host] [count]
+
+Times GET /led and POST /led/on over a fresh HTTP connection each (what
+the app does today), then PING, LED and STATUS over one WebSocket.
+Standard library only.
+"""
+
+import base64
+import os
+import socket
+import statistics
+import struct
+import sys
+import time
+
+HOST = sys.argv[1] if len(sys.argv) > 1 else "192.168.7.1"
+COUNT = int(sys.argv[2]) if len(sys.argv) > 2 else 200
+
+
+def http(method, path):
+    with socket.create_connection((HOST, 80)) as s:
+        s.sendall(f"{method} {path} HTTP/1.1\r\nHost: {HOST}\r\n"
+                  "Content-Length: 0\r\nConnection: close\r\n\r\n".encode())
+        while s.recv(4096):
+            pass
+
+
+def ws_connect():
+    s = socket.create_connection((HOST, 80))
+    s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    key = base64.b64encode(os.urandom(16)).decode()
+    s.sendall(f"GET /ws HTTP/1.1\r\nHost: {HOST}\r\nUpgrade: websocket\r\n"
+              f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\n"
+              "Sec-WebSocket-Version: 13\r\n\r\n".encode())
+    resp = b""
+    while b"\r\n\r\n" not in resp:
+        resp += s.recv(1024)
+    if b" 101 " not in resp.split(b"\r\n", 1)[0]:
+        raise SystemExit("WebSocket handshake failed: " + resp.decode(errors="replace"))
+    return s
+
+
+def ws_send(s, payload):
+    mask = os.urandom(4)
+    body = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+    s.sendall(struct.pack("!BB", 0x82, 0x80 | len(payload)) + mask + body)
+
+
+def recv_exact(s, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = s.recv(n - len(buf))
+        if not chunk:
+            raise SystemExit("connection closed")
+        buf += chunk
+    return buf
+
+
+def ws_recv(s):
+    op, ln = recv_exact(s, 2)
+    ln &= 0x7F
+    if ln == 126:
+        ln = struct.unpack("!H", recv_exact(s, 2))[0]
+    elif ln == 127:
+        ln = struct.unpack("!Q", recv_exact(s, 8))[0]
+    return op & 0x0F, recv_exact(s, ln)
+
+
+def ws_call(s, op, tag, args=b""):
+    ws_send(s, bytes([op, tag]) + args)
+    while True:
+        kind, data = ws_recv(s)
+        if kind == 0x2 and data[0] == 0x80 | op and data[1] == tag:
+            return data
+
+
+def bench(name, fn):
+    samples = []
+    for i in range(COUNT):
+        t = time.perf_counter()
+        fn(i)
+        samples.append((time.perf_counter() - t) * 1000)
+    samples.sort()
+    print(f"{name:22s} median {statistics.median(samples):6.2f} ms  "
+          f"p95 {samples[int(len(samples) * 0.95) - 1]:6.2f} ms")
+
+
+def main():
+    bench("HTTP GET /led", lambda i: http("GET", "/led"))
+    bench("HTTP POST /led/on", lambda i: http("POST", "/led/on"))
+
+    s = ws_connect()
+    bench("WS PING", lambda i: ws_call(s, 0x10, i & 0xFF, struct.pack("<d", time.time())))
+    bench("WS LED on", lambda i: ws_call(s, 0x11, i & 0xFF, b"\x01"))
+    bench("WS STATUS", lambda i: ws_call(s, 0x12, i & 0xFF))
+    s.close()
+
+
+if __name__ == "__main__":
+    main()